@@ -12,6 +12,9 @@ const PATH_PREFIX: &str = "build/";
 const BUF_SIZE: usize = 8 * 1024;
 const CKB_HASH_PERSONALIZATION: &[u8] = b"ckb-default-hash";
 
+// blake2b hashes of the binaries built by `make all-via-docker`. When a C
+// source changes, rebuild it and put the actual hash, printed when this check
+// fails, here.
 const BINARIES: &[(&str, &str)] = &[
     (
         "secp256k1_data",
@@ -0,0 +1,78 @@
+#ifndef XUDT_RCE_SIMULATOR_C_ARENA_H_
+#define XUDT_RCE_SIMULATOR_C_ARENA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+A scratch arena for the big buffers which used to live on stack. It's used as
+a stack: buffers are released in the reverse order of allocation, by going
+back to a mark. Buffers of different phases which are never live at the same
+time share the same memory.
+
+The size is fixed at build time by ARENA_SIZE, it must be defined before this
+file is included. The peak usage of every phase is recorded, so the
+reservation can be checked against real transactions.
+ */
+#define ARENA_ALIGN 16
+#define ARENA_MAX_PHASE_COUNT 8
+#define ARENA_ROUND_UP(size) (((size) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+typedef struct Arena {
+  uint32_t used;
+  uint32_t phase;
+  uint32_t peak[ARENA_MAX_PHASE_COUNT];
+} Arena;
+
+uint8_t g_arena_buff[ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+Arena g_arena;
+
+void arena_reset(void) {
+  g_arena.used = 0;
+  g_arena.phase = 0;
+  for (uint32_t i = 0; i < ARENA_MAX_PHASE_COUNT; i++) {
+    g_arena.peak[i] = 0;
+  }
+}
+
+// memory allocated in later phases is accounted to the new phase
+void arena_enter_phase(uint32_t phase) {
+  if (phase < ARENA_MAX_PHASE_COUNT) {
+    g_arena.phase = phase;
+    if (g_arena.peak[phase] < g_arena.used) {
+      g_arena.peak[phase] = g_arena.used;
+    }
+  }
+}
+
+uint32_t arena_mark(void) { return g_arena.used; }
+
+// return NULL when there is no enough space
+void *arena_alloc(uint32_t size) {
+  uint32_t aligned_size = ARENA_ROUND_UP(size);
+  if (aligned_size < size || aligned_size > ARENA_SIZE - g_arena.used) {
+    return NULL;
+  }
+  void *ptr = &g_arena_buff[g_arena.used];
+  g_arena.used += aligned_size;
+  if (g_arena.peak[g_arena.phase] < g_arena.used) {
+    g_arena.peak[g_arena.phase] = g_arena.used;
+  }
+  return ptr;
+}
+
+// release all the buffers allocated after "mark"
+void arena_release(uint32_t mark) {
+  if (mark < g_arena.used) {
+    g_arena.used = mark;
+  }
+}
+
+uint32_t arena_peak(uint32_t phase) {
+  if (phase < ARENA_MAX_PHASE_COUNT) {
+    return g_arena.peak[phase];
+  }
+  return 0;
+}
+
+#endif  // XUDT_RCE_SIMULATOR_C_ARENA_H_
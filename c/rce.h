@@ -1,5 +1,7 @@
 #ifndef XUDT_RCE_SIMULATOR_C_RCE_H_
 #define XUDT_RCE_SIMULATOR_C_RCE_H_
+#include <stdlib.h>
+
 #include "ckb_smt.h"
 #include "xudt_rce_mol.h"
 #include "xudt_rce_mol2.h"
@@ -41,6 +43,7 @@ enum ErrorCode {
   ERROR_APPEND_ONLY,
   ERROR_EOF,
   ERROR_TOO_LONG_PROOF,
+  ERROR_UNSORTED_LIST,
 };
 
 #define CHECK2(cond, code) \
@@ -69,18 +72,74 @@ int get_extension_data(uint32_t index, uint8_t* buff, uint32_t buff_len,
 #define MAX_EXTENSION_DATA_SIZE 32768
 #define MAX_LOCK_SCRIPT_HASH_COUNT 2048
 #define MAX_RCRULES_COUNT 8192
+// RCRules are verified as soon as they're found, only the first ones are kept
+// for the RCData cells referenced again
+#define MAX_CACHED_RCRULES_COUNT 512
 #define MAX_RECURSIVE_DEPTH 16
-#define MAX_TEMP_PROOF_LENGTH 32768
+// proofs which are not in the cache of witness are read into arena, longer
+// ones are rejected
+#define MAX_RCE_PROOF_LENGTH (256 * 1024)
+#define MAX_INDEXED_CELL_COUNT 1024
+// must be power of 2
+#define MAX_VISITED_RCDATA_COUNT 512
+// a RCData cell up to this size is loaded with one syscall, e.g. a RCCellVec of
+// 31 hashes. The bigger ones are read on demand.
+#define RCE_CELL_DATA_CACHE_SIZE 1024
 
 // RC stands for Regulation Compliance
 typedef struct RCRule {
   uint8_t smt_root[32];
   uint8_t flags;
+  // a RCSortedList, it has no smt_root and no proof. "list_sides" are the sides
+  // (RCE_IN_INPUT, RCE_IN_OUTPUT) with all lock script hashes on a white list,
+  // or with any of them on a black list.
+  bool sorted_list;
+  uint8_t list_sides;
 } RCRule;
 
+// RCData cells are looked up by type hash, the cells are indexed once per
+// rce_validate instead of scanned for every RCData cell.
+typedef struct RceCellIndexEntry {
+  uint8_t type_hash[BLAKE2B_BLOCK_SIZE];
+  uint32_t source;
+  uint32_t index;
+} RceCellIndexEntry;
+
+typedef struct RceCellIndex {
+  // sorted by type hash, cell deps come before inputs
+  RceCellIndexEntry entries[MAX_INDEXED_CELL_COUNT];
+  uint32_t count;
+  bool inputs_indexed;
+  // false when there are more cells than MAX_INDEXED_CELL_COUNT, the cells
+  // missing in index are then looked up by a linear scan
+  bool deps_complete;
+  bool inputs_complete;
+} RceCellIndex;
+
+// A RCData cell already gathered, its RCRules are
+// rcrules[start, start + count). RC graphs often share sub-graphs, e.g. a base
+// black list used by many rule sets, also across the RCE extensions of the
+// same script.
+typedef struct RceVisitedCell {
+  uint8_t hash[BLAKE2B_BLOCK_SIZE];
+  uint32_t start;
+  uint32_t count;
+  // depth of the deepest RCData cell below it
+  uint32_t height;
+  bool used;
+} RceVisitedCell;
+
 typedef struct RceState {
-  RCRule rcrules[MAX_RCRULES_COUNT];
+  // the first MAX_CACHED_RCRULES_COUNT RCRules appended, by all rce_validate
+  // calls of this run. cached_rcrules_count is the count of them.
+  RCRule rcrules[MAX_CACHED_RCRULES_COUNT];
+  uint32_t cached_rcrules_count;
+  // count of RCRules found in the current RC graph
   uint32_t rcrules_count;
+  // count of the ones with SMT, each of them has a proof
+  uint32_t smt_rcrules_count;
+  // count of proofs in witness, there can't be more RCRules than it
+  uint32_t proofs_count;
   bool has_wl;
   bool both_on_wl;
   bool input_on_wl;
@@ -90,21 +149,75 @@ typedef struct RceState {
   // continue looking for rcrules in input cells
   // after failed searching on dep cells.
   bool rcrules_in_input_cell;
+
+  RceCellIndex cell_index;
+  // open addressing hash table, keyed by RCData cell hash
+  RceVisitedCell visited[MAX_VISITED_RCDATA_COUNT];
+  uint32_t visited_count;
+
+  // set by rce_validate: every RCRule is verified with the proof at the same
+  // index when it's found
+  bool verify_rcrules;
+  SmtProofEntryVecType proofs;
+  // lock script hashes, collected before the first RCRule is verified. The
+  // input and output ones are filtered into "view_states" when needed.
+  bool states_collected;
+  smt_state_t states;
+  smt_state_t view_states;
+  // RCE_IN_INPUT or RCE_IN_OUTPUT, 0 when view_states isn't filled
+  uint8_t view;
 } RceState;
 
-void rce_init_state(RceState* state) {
+// rce_validate allocates its big buffers from arena instead of stack
+#define RCE_ARENA_SIZE                                                   \
+  (ARENA_ROUND_UP(sizeof(RceState)) +                                    \
+   2 * ARENA_ROUND_UP(MAX_LOCK_SCRIPT_HASH_COUNT * sizeof(smt_pair_t)) + \
+   ARENA_ROUND_UP(MAX_RCE_PROOF_LENGTH))
+#ifndef ARENA_SIZE
+#define ARENA_SIZE RCE_ARENA_SIZE
+#endif
+#include "arena.h"
+
+// The RceState shared by the RCE extensions of one script: lock hashes, cell
+// index and RCRules gathered are the same for all of them. It lives in arena,
+// below the mark of every rce_validate call, until rce_reset.
+RceState* g_rce_state = NULL;
+
+void rce_reset(void) { g_rce_state = NULL; }
+
+// reset the fields of one RC graph
+void rce_begin_rcrules(RceState* state) {
   state->rcrules_count = 0;
+  state->smt_rcrules_count = 0;
+  state->proofs_count = MAX_RCRULES_COUNT;
   state->has_wl = false;
   state->both_on_wl = false;
   state->input_on_wl = false;
   state->output_on_wl = false;
+  state->verify_rcrules = false;
+}
+
+void rce_init_state(RceState* state) {
+  rce_begin_rcrules(state);
+  state->cached_rcrules_count = 0;
   state->rcrules_in_input_cell = false;
+  state->cell_index.count = 0;
+  state->cell_index.inputs_indexed = false;
+  state->cell_index.deps_complete = false;
+  state->cell_index.inputs_complete = false;
+  for (uint32_t i = 0; i < MAX_VISITED_RCDATA_COUNT; i++) {
+    state->visited[i].used = false;
+  }
+  state->visited_count = 0;
+  state->states_collected = false;
+  state->view = 0;
 }
 
 // molecule doesn't provide names
 typedef enum RCDataUnionType {
   RCDataUnionRule = 0,
-  RCDataUnionCellVec = 1
+  RCDataUnionCellVec = 1,
+  RCDataUnionSortedList = 2
 } RCDataUnionType;
 
 // RCE scripts leverage optimized sparse merkle tree
@@ -139,34 +252,28 @@ static uint32_t rce_read_from_cell_data(uintptr_t* arg, uint8_t* ptr,
   }
 }
 
-int make_cursor_from_witness(WitnessArgsType* witness, bool* use_input_type);
+int get_extension_data_cursor(uint32_t index, mol2_cursor_t* cur);
 
+// The header of SmtProofEntryVec is verified. It's cheap, xUDT checks the
+// proofs of the last RCE extension before anything expensive is done.
 static int rce_get_proofs(uint32_t index, SmtProofEntryVecType* res) {
   int err = 0;
-  bool use_input_type = true;
-  WitnessArgsType witness;
-
-  err = make_cursor_from_witness(&witness, &use_input_type);
+  mol2_cursor_t extension_data;
+  err = get_extension_data_cursor(index, &extension_data);
   CHECK(err);
-
-  BytesOptType input;
-  if (use_input_type) {
-    input = witness.t->input_type(&witness);
-  } else {
-    input = witness.t->output_type(&witness);
+  uint8_t header[MOL_NUM_T_SIZE * 2] = {0};
+  uint32_t header_len = mol2_read_at(&extension_data, header, sizeof(header));
+  CHECK2(header_len >= MOL_NUM_T_SIZE &&
+             mol_unpack_number(header) == extension_data.size,
+         ERROR_INVALID_MOL_FORMAT);
+  if (extension_data.size > MOL_NUM_T_SIZE) {
+    CHECK2(header_len == sizeof(header), ERROR_INVALID_MOL_FORMAT);
+    mol_num_t first_offset = mol_unpack_number(header + MOL_NUM_T_SIZE);
+    CHECK2(first_offset % MOL_NUM_T_SIZE == 0 &&
+               first_offset >= MOL_NUM_T_SIZE * 2 &&
+               first_offset <= extension_data.size,
+           ERROR_INVALID_MOL_FORMAT);
   }
-  CHECK2(!input.t->is_none(&input), ERROR_INVALID_MOL_FORMAT);
-
-  mol2_cursor_t bytes = input.t->unwrap(&input);
-  // convert Bytes to XudtWitnessInputType
-  XudtWitnessInputType witness_input = make_XudtWitnessInput(&bytes);
-  BytesVecType extension_data_vec =
-      witness_input.t->extension_data(&witness_input);
-
-  bool existing = false;
-  mol2_cursor_t extension_data =
-      extension_data_vec.t->get(&extension_data_vec, index, &existing);
-  CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
 
   res->cur = extension_data;
   res->t = GetSmtProofEntryVecVTable();
@@ -181,23 +288,25 @@ static int rce_make_cursor_from_cell_data(uint8_t* data_source,
                                           mol2_cursor_t* cell_data,
                                           size_t index, size_t source) {
   int err = 0;
-  uint64_t cell_data_len = 0;
-  err = ckb_load_cell_data(NULL, &cell_data_len, 0, index, source);
+  mol2_data_source_t* ptr = (mol2_data_source_t*)data_source;
+  // the cache is filled with the beginning of cell data, it's the whole cell
+  // data mostly
+  uint64_t cell_data_len = max_cache_size;
+  err = ckb_load_cell_data(ptr->cache, &cell_data_len, 0, index, source);
   CHECK(err);
   CHECK2(cell_data_len > 0, ERROR_INVALID_MOL_FORMAT);
 
   cell_data->offset = 0;
   cell_data->size = cell_data_len;
 
-  mol2_data_source_t* ptr = (mol2_data_source_t*)data_source;
-
   ptr->read = rce_read_from_cell_data;
   ptr->total_size = cell_data_len;
   // pass index and source as args
   ptr->args[0] = (uintptr_t)index;
   ptr->args[1] = source;
 
-  ptr->cache_size = 0;
+  ptr->cache_size =
+      cell_data_len < max_cache_size ? cell_data_len : max_cache_size;
   ptr->start_point = 0;
   ptr->max_cache_size = max_cache_size;
 
@@ -241,87 +350,156 @@ int ckb_look_for_input_with_hash2(const uint8_t* code_hash, uint8_t hash_type,
   return CKB_INDEX_OUT_OF_BOUND;
 }
 
-// Note: RCRules is ordered as depth-first search
-int rce_gather_rcrules_recursively(RceState* rce_state,
-                                   const uint8_t* rce_cell_hash, int depth) {
-  int err = 0;
+static int rce_compare_index_entry(const void* a, const void* b) {
+  const RceCellIndexEntry* x = (const RceCellIndexEntry*)a;
+  const RceCellIndexEntry* y = (const RceCellIndexEntry*)b;
+  int ret = memcmp(x->type_hash, y->type_hash, BLAKE2B_BLOCK_SIZE);
+  if (ret != 0) return ret;
+  // same order as the linear scans: cell deps first, then lower index
+  bool x_is_dep = x->source == CKB_SOURCE_CELL_DEP;
+  bool y_is_dep = y->source == CKB_SOURCE_CELL_DEP;
+  if (x_is_dep != y_is_dep) return x_is_dep ? -1 : 1;
+  if (x->index != y->index) return x->index < y->index ? -1 : 1;
+  return 0;
+}
 
-  if (depth > MAX_RECURSIVE_DEPTH) return ERROR_RCRULES_TOO_DEEP;
+// append type hashes of cells from "source", return true when all cells are
+// indexed
+static bool rce_index_cells(RceCellIndex* cell_index, size_t source) {
+  size_t current = 0;
+  while (true) {
+    if (cell_index->count >= MAX_INDEXED_CELL_COUNT) return false;
+    RceCellIndexEntry* entry = &cell_index->entries[cell_index->count];
+    uint64_t len = BLAKE2B_BLOCK_SIZE;
+    int ret = ckb_load_cell_by_field(entry->type_hash, &len, 0, current,
+                                     source, CKB_CELL_FIELD_TYPE_HASH);
+    if (ret == CKB_SUCCESS && len == BLAKE2B_BLOCK_SIZE) {
+      entry->source = (uint32_t)source;
+      entry->index = (uint32_t)current;
+      cell_index->count++;
+    } else if (ret != CKB_ITEM_MISSING) {
+      // same as ckb_look_for_dep_with_hash2, the other errors end the scan
+      return true;
+    }
+    current++;
+  }
+}
 
-  size_t index = 0;
-  size_t source = CKB_SOURCE_CELL_DEP;
+// one syscall per cell, instead of one per cell for every RCData cell
+void rce_build_cell_index(RceCellIndex* cell_index, bool with_inputs) {
+  cell_index->count = 0;
+  cell_index->deps_complete = rce_index_cells(cell_index, CKB_SOURCE_CELL_DEP);
+  cell_index->inputs_indexed = with_inputs;
+  cell_index->inputs_complete =
+      with_inputs && rce_index_cells(cell_index, CKB_SOURCE_INPUT);
+  qsort(cell_index->entries, cell_index->count, sizeof(RceCellIndexEntry),
+        rce_compare_index_entry);
+}
 
-  // note: RCE Cell is with hash_type = 1
-  err = ckb_look_for_dep_with_hash2(rce_cell_hash, 1, &index);
-  if (err != 0) {
-    if (rce_state->rcrules_in_input_cell) {
-      err = ckb_look_for_input_with_hash2(rce_cell_hash, 1, &index);
-      if (err != 0) {
-        return err;
-      } else {
-        source = CKB_SOURCE_INPUT;
-      };
+// first entry with "type_hash", or NULL
+static const RceCellIndexEntry* rce_lookup_cell_index(
+    const RceCellIndex* cell_index, const uint8_t* type_hash) {
+  uint32_t low = 0;
+  uint32_t high = cell_index->count;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
+    if (memcmp(cell_index->entries[mid].type_hash, type_hash,
+               BLAKE2B_BLOCK_SIZE) < 0) {
+      low = mid + 1;
     } else {
-      return err;
+      high = mid;
     }
   }
+  if (low < cell_index->count &&
+      memcmp(cell_index->entries[low].type_hash, type_hash,
+             BLAKE2B_BLOCK_SIZE) == 0) {
+    return &cell_index->entries[low];
+  }
+  return NULL;
+}
 
-  // data_source's lifetime should be long enough, it can't be defined inside
-  // rce_make_cursor_from_cell_data
-  const uint32_t max_cache_size = 128;
-  uint8_t data_source_buff[MOL2_DATA_SOURCE_LEN(128)];
-
-  mol2_cursor_t cell_data;
-  err = rce_make_cursor_from_cell_data(data_source_buff, max_cache_size,
-                                       &cell_data, index, source);
-  CHECK(err);
-
-  RCDataType rc_data = make_RCData(&cell_data);
-
-  uint32_t item_id = rc_data.t->item_id(&rc_data);
-  if (item_id == RCDataUnionRule) {
-    RCRuleType rule = rc_data.t->as_RCRule(&rc_data);
-    // "Any more RCRule structures will result in an immediate failure."
-    CHECK2(rce_state->rcrules_count < MAX_RCRULES_COUNT,
-           ERROR_TOO_MANY_RCRULES);
-
-    uint8_t flags = rule.t->flags(&rule);
-    if (rce_is_emergency_halt_mode(flags)) {
-      err = ERROR_RCE_EMERGENCY_HALT;
-      // the emergency halt has the highest priority, can return immediately
-      goto exit;
+// look for the RCData cell with "rce_cell_hash" as type hash, in cell deps
+// first, then in inputs if allowed
+int rce_find_rcdata_cell(const RceState* rce_state,
+                         const uint8_t* rce_cell_hash, size_t* index,
+                         size_t* source) {
+  int err = 0;
+  const RceCellIndex* cell_index = &rce_state->cell_index;
+  const RceCellIndexEntry* entry =
+      rce_lookup_cell_index(cell_index, rce_cell_hash);
+  if (entry != NULL && entry->source == CKB_SOURCE_CELL_DEP) {
+    *index = entry->index;
+    *source = CKB_SOURCE_CELL_DEP;
+    return 0;
+  }
+  err = CKB_INDEX_OUT_OF_BOUND;
+  if (!cell_index->deps_complete) {
+    // note: RCE Cell is with hash_type = 1
+    err = ckb_look_for_dep_with_hash2(rce_cell_hash, 1, index);
+    if (err == 0) {
+      *source = CKB_SOURCE_CELL_DEP;
+      return 0;
     }
-
-    if (rce_is_white_list(flags)) {
-      rce_state->has_wl = true;
+  }
+  if (!rce_state->rcrules_in_input_cell) {
+    return err;
+  }
+  if (cell_index->inputs_indexed) {
+    // cell deps are sorted before inputs, so it can only be an input here
+    if (entry != NULL) {
+      *index = entry->index;
+      *source = CKB_SOURCE_INPUT;
+      return 0;
     }
-    rce_state->rcrules[rce_state->rcrules_count].flags = flags;
-    mol2_cursor_t smt_root = rule.t->smt_root(&rule);
-    uint32_t read_len = mol2_read_at(
-        &smt_root, rce_state->rcrules[rce_state->rcrules_count].smt_root,
-        SMT_KEY_BYTES);
-    CHECK2(read_len == SMT_KEY_BYTES, ERROR_INVALID_MOL_FORMAT);
-
-    rce_state->rcrules_count++;
-  } else if (item_id == RCDataUnionCellVec) {
-    RCCellVecType cell_vec = rc_data.t->as_RCCellVec(&rc_data);
+    if (cell_index->inputs_complete) {
+      return CKB_INDEX_OUT_OF_BOUND;
+    }
+  }
+  err = ckb_look_for_input_with_hash2(rce_cell_hash, 1, index);
+  if (err == 0) {
+    *source = CKB_SOURCE_INPUT;
+  }
+  return err;
+}
 
-    uint32_t len = cell_vec.t->len(&cell_vec);
-    for (uint32_t i = 0; i < len; i++) {
-      uint8_t hash[BLAKE2B_BLOCK_SIZE];
+// Where a lock script hash is from. They're kept in "order" of smt_pair_t,
+// which is only used while sorting.
+#define RCE_IN_INPUT 0x1
+#define RCE_IN_OUTPUT 0x2
 
-      bool existing = false;
-      mol2_cursor_t item = cell_vec.t->get(&cell_vec, i, &existing);
-      CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
-      CHECK2(item.size == BLAKE2B_BLOCK_SIZE, ERROR_INVALID_MOL_FORMAT);
+// lock script hashes of group input and output cells
+int rce_collect_hashes(smt_state_t* states) {
+  int err = 0;
+  uint8_t lock_script_hash[SMT_KEY_BYTES];
+  uint64_t lock_script_hash_len = SMT_KEY_BYTES;
 
-      uint32_t read_len = mol2_read_at(&item, hash, sizeof(hash));
-      CHECK2(read_len == sizeof(hash), ERROR_INVALID_MOL_FORMAT);
-      err = rce_gather_rcrules_recursively(rce_state, hash, depth + 1);
+  size_t sources[2] = {CKB_SOURCE_GROUP_INPUT, CKB_SOURCE_GROUP_OUTPUT};
+  uint32_t bits[2] = {RCE_IN_INPUT, RCE_IN_OUTPUT};
+  for (int i = 0; i < 2; i++) {
+    uint32_t index = 0;
+    while (true) {
+      err = ckb_checked_load_cell_by_field(
+          lock_script_hash, &lock_script_hash_len, 0, index, sources[i],
+          CKB_CELL_FIELD_LOCK_HASH);
+      if (err == CKB_INDEX_OUT_OF_BOUND) {
+        break;
+      }
+      uint32_t len = states->len;
+      err = smt_state_insert(states, lock_script_hash, SMT_VALUE_EMPTY);
       CHECK(err);
+      if (states->len > len) {
+        states->pairs[len].order = bits[i];
+      } else {
+        // it's full, the last pair with same key is updated in place
+        int32_t j = (int32_t)len - 1;
+        while (memcmp(states->pairs[j].key, lock_script_hash, SMT_KEY_BYTES) !=
+               0) {
+          j--;
+        }
+        states->pairs[j].order |= bits[i];
+      }
+      index++;
     }
-  } else {
-    CHECK2(false, ERROR_INVALID_MOL_FORMAT);
   }
 
   err = 0;
@@ -329,47 +507,159 @@ exit:
   return err;
 }
 
-int rce_collect_hashes(smt_state_t* states, smt_state_t* input_states,
-                       smt_state_t* output_states) {
-  int err = 0;
-  uint32_t index = 0;
+// same order of keys as smt_state_normalize
+static int rce_compare_key(const void* a, const void* b) {
+  const uint8_t* x = ((const smt_pair_t*)a)->key;
+  const uint8_t* y = ((const smt_pair_t*)b)->key;
+  for (int i = SMT_KEY_BYTES - 1; i >= 0; i--) {
+    if (x[i] != y[i]) return x[i] < y[i] ? -1 : 1;
+  }
+  return 0;
+}
 
-  uint8_t lock_script_hash[SMT_KEY_BYTES];
-  uint64_t lock_script_hash_len = SMT_KEY_BYTES;
+// buckets up to this size are sorted by insertion sort
+#define RCE_RADIX_SORT_CUTOFF 16
+
+static void rce_insertion_sort(smt_pair_t* pairs, uint32_t len) {
+  for (uint32_t i = 1; i < len; i++) {
+    if (rce_compare_key(&pairs[i - 1], &pairs[i]) <= 0) continue;
+    smt_pair_t pair = pairs[i];
+    uint32_t j = i;
+    while (j > 0 && rce_compare_key(&pairs[j - 1], &pair) > 0) {
+      pairs[j] = pairs[j - 1];
+      j--;
+    }
+    pairs[j] = pair;
+  }
+}
 
-  index = 0;
-  while (true) {
-    err = ckb_checked_load_cell_by_field(
-        lock_script_hash, &lock_script_hash_len, 0, index,
-        CKB_SOURCE_GROUP_INPUT, CKB_CELL_FIELD_LOCK_HASH);
-    if (err == CKB_INDEX_OUT_OF_BOUND) {
-      break;
+// Swap the pairs into 256 buckets by key[byte], the bytes shared by all keys
+// are skipped first. Returns the byte used, or -1 when all keys are the same.
+// It's not inlined: the counters stay out of the frames of rce_sort_pairs.
+static __attribute__((noinline)) int rce_radix_partition(smt_pair_t* pairs,
+                                                         uint32_t len,
+                                                         int byte) {
+  uint32_t count[256] = {0};
+  uint32_t next[256];
+  for (; byte >= 0; byte--) {
+    for (uint32_t i = 0; i < len; i++) {
+      count[pairs[i].key[byte]]++;
     }
-    err = smt_state_insert(states, lock_script_hash, SMT_VALUE_EMPTY);
-    CHECK(err);
-    err = smt_state_insert(input_states, lock_script_hash, SMT_VALUE_EMPTY);
-    CHECK(err);
+    if (count[pairs[0].key[byte]] != len) break;
+    count[pairs[0].key[byte]] = 0;
+  }
+  if (byte < 0) return -1;
 
-    index++;
+  uint32_t start = 0;
+  for (uint32_t b = 0; b < 256; b++) {
+    next[b] = start;
+    start += count[b];
   }
-  index = 0;
-  while (true) {
-    err = ckb_checked_load_cell_by_field(
-        lock_script_hash, &lock_script_hash_len, 0, index,
-        CKB_SOURCE_GROUP_OUTPUT, CKB_CELL_FIELD_LOCK_HASH);
-    if (err == CKB_INDEX_OUT_OF_BOUND) {
-      break;
+  start = 0;
+  for (uint32_t b = 0; b < 256; b++) {
+    uint32_t end = start + count[b];
+    while (next[b] < end) {
+      uint8_t d = pairs[next[b]].key[byte];
+      if (d == b) {
+        next[b]++;
+      } else {
+        smt_pair_t pair = pairs[next[b]];
+        pairs[next[b]] = pairs[next[d]];
+        pairs[next[d]++] = pair;
+      }
     }
-    err = smt_state_insert(states, lock_script_hash, SMT_VALUE_EMPTY);
-    CHECK(err);
-    err = smt_state_insert(output_states, lock_script_hash, SMT_VALUE_EMPTY);
-    CHECK(err);
-    index++;
+    start = end;
   }
+  return byte;
+}
 
-  err = 0;
-exit:
-  return err;
+// In-place MSD radix sort of the keys, in the order of rce_compare_key. The
+// keys are equal above "byte", which is the next one to look at. The pairs
+// are swapped into their buckets, so it's not stable: the callers resolve
+// duplicated keys by "order".
+// The recursion is at most SMT_KEY_BYTES deep and the buckets are found again
+// by scanning, so only one set of counters is on the stack at any time.
+void rce_sort_pairs(smt_pair_t* pairs, uint32_t len, int byte) {
+  if (len <= RCE_RADIX_SORT_CUTOFF) {
+    rce_insertion_sort(pairs, len);
+    return;
+  }
+  byte = rce_radix_partition(pairs, len, byte);
+  // all keys are the same
+  if (byte < 0) return;
+
+  for (uint32_t start = 0; start < len;) {
+    uint8_t d = pairs[start].key[byte];
+    uint32_t end = start + 1;
+    while (end < len && pairs[end].key[byte] == d) {
+      end++;
+    }
+    if (end - start > 1) {
+      rce_sort_pairs(pairs + start, end - start, byte - 1);
+    }
+    start = end;
+  }
+}
+
+// The same result as smt_state_normalize: keys are sorted and for the
+// duplicated ones, the value inserted last wins.
+void rce_state_normalize(smt_state_t* states) {
+  for (uint32_t i = 0; i < states->len; i++) {
+    states->pairs[i].order = i;
+  }
+  rce_sort_pairs(states->pairs, states->len, SMT_KEY_BYTES - 1);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < states->len; i++) {
+    if (count > 0 && memcmp(states->pairs[count - 1].key, states->pairs[i].key,
+                            SMT_KEY_BYTES) == 0) {
+      if (states->pairs[i].order > states->pairs[count - 1].order) {
+        states->pairs[count - 1] = states->pairs[i];
+      }
+    } else {
+      if (count != i) {
+        states->pairs[count] = states->pairs[i];
+      }
+      count++;
+    }
+  }
+  states->len = count;
+}
+
+// Sort the keys and remove the duplicated ones, like smt_state_normalize. The
+// sources of duplicated keys are merged. The values are all empty.
+void rce_normalize_hashes(smt_state_t* states) {
+  rce_sort_pairs(states->pairs, states->len, SMT_KEY_BYTES - 1);
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < states->len; i++) {
+    if (count > 0 &&
+        memcmp(states->pairs[count - 1].key, states->pairs[i].key,
+               SMT_KEY_BYTES) == 0) {
+      states->pairs[count - 1].order |= states->pairs[i].order;
+    } else {
+      if (count != i) {
+        states->pairs[count] = states->pairs[i];
+      }
+      count++;
+    }
+  }
+  states->len = count;
+}
+
+// The keys from one source (RCE_IN_INPUT or RCE_IN_OUTPUT), they're already
+// sorted. It's filled once for consecutive rules with the same mask.
+smt_state_t* rce_get_view_states(RceState* rce_state, uint8_t view) {
+  smt_state_t* view_states = &rce_state->view_states;
+  if (rce_state->view != view) {
+    const smt_state_t* states = &rce_state->states;
+    view_states->len = 0;
+    for (uint32_t i = 0; i < states->len; i++) {
+      if (states->pairs[i].order & view) {
+        view_states->pairs[view_states->len++] = states->pairs[i];
+      }
+    }
+    rce_state->view = view;
+  }
+  return view_states;
 }
 
 void rce_set_states_black_list(smt_state_t* states) {
@@ -390,19 +680,49 @@ inline static bool _mask_has_output(uint8_t mask) { return 0x2 & mask; }
 
 inline static bool _mask_has_both(uint8_t mask) { return mask == 3; }
 
-int rce_verify_one_rule(RceState* rce_state, smt_state_t* states,
-                        smt_state_t* input_states, smt_state_t* output_states,
-                        uint8_t proof_mask, mol2_cursor_t proof,
-                        const RCRule* current_rule) {
+// Proof bytes are borrowed from the cache of the data source (witness) when
+// they fit in it, without memcpy. The cache is refilled from the beginning of
+// proof unless it already holds the whole proof, a cached head isn't enough.
+// Longer proofs are read with one read of the data source into a buffer of
+// their exact size, MAX_RCE_PROOF_LENGTH of the arena is kept for them.
+static int rce_borrow_proof(const mol2_cursor_t* proof, const uint8_t** ptr) {
   int err = 0;
+  mol2_data_source_t* ds = proof->data_source;
+  if (proof->size <= ds->max_cache_size) {
+    if (proof->offset < ds->start_point ||
+        proof->offset - ds->start_point + proof->size > ds->cache_size) {
+      // same refill as mol2_read_at
+      uint32_t size =
+          ds->read(ds->args, ds->cache, ds->max_cache_size, proof->offset);
+      CHECK2(size >= proof->size, ERROR_INVALID_MOL_FORMAT);
+      ds->cache_size = size;
+      ds->start_point = proof->offset;
+    }
+    *ptr = ds->cache + (proof->offset - ds->start_point);
+    return 0;
+  }
+  CHECK2(proof->size <= MAX_RCE_PROOF_LENGTH, ERROR_TOO_LONG_PROOF);
+  uint8_t* buff = arena_alloc(proof->size);
+  CHECK2(buff != NULL, ERROR_NOT_ENOUGH_BUFF);
+  uint32_t read_len = ds->read(ds->args, buff, proof->size, proof->offset);
+  CHECK2(read_len == proof->size, ERROR_INVALID_MOL_FORMAT);
+  *ptr = buff;
+exit:
+  return err;
+}
+
+int rce_verify_one_rule(RceState* rce_state, uint8_t proof_mask,
+                        mol2_cursor_t proof, const RCRule* current_rule) {
+  int err = 0;
+  smt_state_t* states = &rce_state->states;
+  uint32_t mark = arena_mark();
 
-  uint8_t temp_proof[MAX_TEMP_PROOF_LENGTH];
+  const uint8_t* temp_proof = NULL;
   const uint8_t* root_hash = current_rule->smt_root;
 
-  uint32_t temp_proof_len =
-      mol2_read_at(&proof, temp_proof, MAX_TEMP_PROOF_LENGTH);
-  CHECK2(temp_proof_len == proof.size, ERROR_INVALID_MOL_FORMAT);
-  CHECK2(temp_proof_len < MAX_TEMP_PROOF_LENGTH, ERROR_INVALID_MOL_FORMAT);
+  err = rce_borrow_proof(&proof, &temp_proof);
+  CHECK(err);
+  uint32_t temp_proof_len = proof.size;
 
   if (rce_is_white_list(current_rule->flags)) {
     if (_mask_has_both(proof_mask)) {
@@ -413,12 +733,16 @@ int rce_verify_one_rule(RceState* rce_state, smt_state_t* states,
       }
     } else {
       if (_mask_has_input(proof_mask)) {
+        smt_state_t* input_states =
+            rce_get_view_states(rce_state, RCE_IN_INPUT);
         rce_set_states_white_list(input_states);
         err = smt_verify(root_hash, input_states, temp_proof, temp_proof_len);
         if (err == 0) {
           rce_state->input_on_wl = true;
         }
       } else if (_mask_has_output(proof_mask)) {
+        smt_state_t* output_states =
+            rce_get_view_states(rce_state, RCE_IN_OUTPUT);
         rce_set_states_white_list(output_states);
         err = smt_verify(root_hash, output_states, temp_proof, temp_proof_len);
         if (err == 0) {
@@ -440,70 +764,405 @@ int rce_verify_one_rule(RceState* rce_state, smt_state_t* states,
 
   err = 0;
 exit:
+  arena_release(mark);
   return err;
 }
 
-int rce_validate(int is_owner_mode, size_t extension_index, const uint8_t* args,
-                 size_t args_len) {
-  int err = 0;
-  RceState rce_state;
-  rce_init_state(&rce_state);
+// the slot of "hash", or an unused slot where it can be added
+static RceVisitedCell* rce_visited_slot(RceState* rce_state,
+                                        const uint8_t* hash) {
+  uint32_t key = 0;
+  memcpy(&key, hash, sizeof(key));
+  for (uint32_t i = 0; i < MAX_VISITED_RCDATA_COUNT; i++) {
+    RceVisitedCell* cell =
+        &rce_state->visited[(key + i) & (MAX_VISITED_RCDATA_COUNT - 1)];
+    if (!cell->used ||
+        memcmp(cell->hash, hash, BLAKE2B_BLOCK_SIZE) == 0) {
+      return cell;
+    }
+  }
+  return NULL;
+}
 
-  uint32_t index = 0;
+const RceVisitedCell* rce_find_visited(RceState* rce_state,
+                                       const uint8_t* hash) {
+  const RceVisitedCell* cell = rce_visited_slot(rce_state, hash);
+  if (cell != NULL && cell->used) return cell;
+  return NULL;
+}
 
-  CHECK2(args_len == BLAKE2B_BLOCK_SIZE, ERROR_INVALID_MOL_FORMAT);
-  CHECK2(args != NULL, ERROR_INVALID_RCE_ARGS);
-  if (is_owner_mode) return 0;
+// "start" is rcrules_count and "cached_start" is cached_rcrules_count before
+// the cell is gathered. When the table is full, the cell is simply loaded again
+// next time.
+static void rce_add_visited(RceState* rce_state, const uint8_t* hash,
+                            uint32_t start, uint32_t cached_start,
+                            uint32_t height) {
+  uint32_t count = rce_state->rcrules_count - start;
+  // its RCRules must be cached
+  if (rce_state->cached_rcrules_count - cached_start != count) return;
+  // keep some slots free, so the probing stays short
+  if (rce_state->visited_count >= MAX_VISITED_RCDATA_COUNT * 3 / 4) return;
+  RceVisitedCell* cell = rce_visited_slot(rce_state, hash);
+  if (cell == NULL || cell->used) return;
+  memcpy(cell->hash, hash, BLAKE2B_BLOCK_SIZE);
+  cell->start = cached_start;
+  cell->count = count;
+  cell->height = height;
+  cell->used = true;
+  rce_state->visited_count++;
+}
 
-  err = rce_gather_rcrules_recursively(&rce_state, args, 0);
-  CHECK(err);
+// room for one more RCRule
+static int rce_check_rcrules_count(const RceState* rce_state,
+                                   const RCRule* rule) {
+  int err = 0;
+  // "Any more RCRule structures will result in an immediate failure."
+  CHECK2(rce_state->rcrules_count < MAX_RCRULES_COUNT, ERROR_TOO_MANY_RCRULES);
+  // fail before loading the rest of RCData cells
+  if (!rule->sorted_list) {
+    CHECK2(rce_state->smt_rcrules_count < rce_state->proofs_count,
+           ERROR_RCRULES_PROOFS_MISMATCHED);
+  }
+exit:
+  return err;
+}
 
-  SmtProofEntryVecType proofs;
-  err = rce_get_proofs(extension_index, &proofs);
+static int rce_collect_states(RceState* rce_state) {
+  int err = 0;
+  err = rce_collect_hashes(&rce_state->states);
   CHECK(err);
+  rce_normalize_hashes(&rce_state->states);
+  rce_state->states_collected = true;
+exit:
+  return err;
+}
 
-  uint32_t proof_len = proofs.t->len(&proofs);
-  // count of proof should be same as size of RCRules
-  CHECK2(proof_len == rce_state.rcrules_count, ERROR_RCRULES_PROOFS_MISMATCHED);
+static int rce_verify_sorted_list(RceState* rce_state, const RCRule* rule) {
+  int err = 0;
+  if (rce_is_white_list(rule->flags)) {
+    if (rule->list_sides & RCE_IN_INPUT) {
+      rce_state->input_on_wl = true;
+    }
+    if (rule->list_sides & RCE_IN_OUTPUT) {
+      rce_state->output_on_wl = true;
+    }
+  } else {
+    CHECK2(rule->list_sides == 0, ERROR_ON_BLACK_LIST);
+  }
+exit:
+  return err;
+}
 
-  smt_pair_t entries[MAX_LOCK_SCRIPT_HASH_COUNT];
-  smt_pair_t input_entries[MAX_LOCK_SCRIPT_HASH_COUNT];
-  smt_pair_t output_entries[MAX_LOCK_SCRIPT_HASH_COUNT];
+// Append the RCRule found in depth-first order, and verify it. The RCRules with
+// SMT are verified with the proofs in the same order. A black list hit stops
+// the traversal: the rest of RCData cells are not loaded.
+static int rce_append_rcrule(RceState* rce_state, const RCRule* rule) {
+  int err = 0;
+  err = rce_check_rcrules_count(rce_state, rule);
+  CHECK(err);
+  if (rce_is_white_list(rule->flags)) {
+    rce_state->has_wl = true;
+  }
+  rce_state->rcrules_count++;
+  uint32_t index = rce_state->smt_rcrules_count;
+  if (!rule->sorted_list) {
+    rce_state->smt_rcrules_count++;
+  }
+  if (rce_state->cached_rcrules_count < MAX_CACHED_RCRULES_COUNT) {
+    rce_state->rcrules[rce_state->cached_rcrules_count++] = *rule;
+  }
+  if (!rce_state->verify_rcrules) return 0;
+  if (rule->sorted_list) {
+    return rce_verify_sorted_list(rce_state, rule);
+  }
 
-  smt_state_t states;
-  smt_state_t input_states;
-  smt_state_t output_states;
-  smt_state_init(&states, entries, MAX_LOCK_SCRIPT_HASH_COUNT);
-  smt_state_init(&input_states, input_entries, MAX_LOCK_SCRIPT_HASH_COUNT);
-  smt_state_init(&output_states, output_entries, MAX_LOCK_SCRIPT_HASH_COUNT);
+  if (!rce_state->states_collected) {
+    err = rce_collect_states(rce_state);
+    CHECK(err);
+  }
+  bool existing = false;
+  SmtProofEntryType proof_entry =
+      rce_state->proofs.t->get(&rce_state->proofs, index, &existing);
+  CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
 
-  err = rce_collect_hashes(&states, &input_states, &output_states);
+  uint8_t proof_mask = proof_entry.t->mask(&proof_entry);
+  mol2_cursor_t proof = proof_entry.t->proof(&proof_entry);
+  err = rce_verify_one_rule(rce_state, proof_mask, proof, rule);
   CHECK(err);
+exit:
+  return err;
+}
 
-  smt_state_normalize(&states);
-  smt_state_normalize(&input_states);
-  smt_state_normalize(&output_states);
-
-  err = ERROR_SMT_VERIFY_FAILED;
-  for (index = 0; index < proof_len; index++) {
+// binary search of "key" in a RCSortedList
+static int rce_sorted_list_contains(Byte32VecType* hashes, uint32_t len,
+                                    const uint8_t* key, bool* found) {
+  int err = 0;
+  uint32_t low = 0;
+  uint32_t high = len;
+  *found = false;
+  while (low < high) {
+    uint32_t mid = low + (high - low) / 2;
     bool existing = false;
-    SmtProofEntryType proof_entry = proofs.t->get(&proofs, index, &existing);
+    mol2_cursor_t item = hashes->t->get(hashes, mid, &existing);
     CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+    uint8_t hash[SMT_KEY_BYTES];
+    uint32_t read_len = mol2_read_at(&item, hash, SMT_KEY_BYTES);
+    CHECK2(read_len == SMT_KEY_BYTES, ERROR_INVALID_MOL_FORMAT);
+    int cmp = memcmp(hash, key, SMT_KEY_BYTES);
+    if (cmp == 0) {
+      *found = true;
+      break;
+    } else if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+exit:
+  return err;
+}
+
+// Look for the lock script hashes on a RCSortedList, see RCRule. The order of
+// the list is checked by RCE validator, when the RCData cell is updated.
+static int rce_search_sorted_list(RceState* rce_state, Byte32VecType* hashes,
+                                  uint8_t flags, uint8_t* sides) {
+  int err = 0;
+  if (!rce_state->states_collected) {
+    err = rce_collect_states(rce_state);
+    CHECK(err);
+  }
+  bool white_list = rce_is_white_list(flags);
+  uint32_t len = hashes->t->len(hashes);
+  const smt_state_t* states = &rce_state->states;
+  uint8_t missing = 0;
+  *sides = 0;
+  for (uint32_t i = 0; i < states->len; i++) {
+    bool found = false;
+    err = rce_sorted_list_contains(hashes, len, states->pairs[i].key, &found);
+    CHECK(err);
+    if (white_list && !found) {
+      missing |= states->pairs[i].order;
+    } else if (!white_list && found) {
+      *sides |= states->pairs[i].order;
+      // one is enough
+      break;
+    }
+  }
+  if (white_list) {
+    *sides = (RCE_IN_INPUT | RCE_IN_OUTPUT) & ~missing;
+  }
+exit:
+  return err;
+}
+
+// a RCCellVec being gathered
+typedef struct RceGatherFrame {
+  uint8_t hash[BLAKE2B_BLOCK_SIZE];
+  uint32_t start;
+  uint32_t cached_start;
+  uint32_t height;
+  uint32_t next;
+  uint32_t len;
+  RCCellVecType cell_vec;
+  // data_source's lifetime should be as long as cell_vec
+  uint8_t data_source_buff[MOL2_DATA_SOURCE_LEN(RCE_CELL_DATA_CACHE_SIZE)];
+} RceGatherFrame;
+
+static void rce_update_height(RceGatherFrame* frames, uint32_t frames_count,
+                              uint32_t child_height) {
+  if (frames_count > 0 && frames[frames_count - 1].height < child_height + 1) {
+    frames[frames_count - 1].height = child_height + 1;
+  }
+}
+
+// Note: RCRules is ordered as depth-first search. It's done with an explicit
+// stack of RCCellVec. A RCData cell referenced again is not loaded, the
+// RCRules gathered the first time are appended again, so the order (and the
+// proofs) are the same as loading it.
+// Every RCRule is verified as soon as it's found, so the errors follow the
+// order of RCRules: an emergency halt is reported only when it comes before
+// any black list hit or RCRules/proofs count mismatch. The transaction is
+// rejected either way.
+int rce_gather_rcrules(RceState* rce_state, const uint8_t* root_hash) {
+  int err = 0;
+  RceGatherFrame frames[MAX_RECURSIVE_DEPTH + 1];
+  uint32_t frames_count = 0;
+  uint8_t hash[BLAKE2B_BLOCK_SIZE];
+  memcpy(hash, root_hash, BLAKE2B_BLOCK_SIZE);
 
-    uint8_t proof_mask = proof_entry.t->mask(&proof_entry);
-    mol2_cursor_t proof = proof_entry.t->proof(&proof_entry);
+  while (true) {
+    // visit the RCData cell "hash", "frames_count" is its depth
+    CHECK2(frames_count <= MAX_RECURSIVE_DEPTH, ERROR_RCRULES_TOO_DEEP);
+    const RceVisitedCell* visited = rce_find_visited(rce_state, hash);
+    if (visited != NULL &&
+        frames_count + visited->height <= MAX_RECURSIVE_DEPTH) {
+      for (uint32_t i = 0; i < visited->count; i++) {
+        RCRule rule = rce_state->rcrules[visited->start + i];
+        err = rce_append_rcrule(rce_state, &rule);
+        CHECK(err);
+      }
+      rce_update_height(frames, frames_count, visited->height);
+    } else {
+      size_t index = 0;
+      size_t source = CKB_SOURCE_CELL_DEP;
+      err = rce_find_rcdata_cell(rce_state, hash, &index, &source);
+      if (err != 0) goto exit;
+
+      RceGatherFrame* frame = &frames[frames_count];
+      mol2_cursor_t cell_data;
+      err = rce_make_cursor_from_cell_data(frame->data_source_buff,
+                                           RCE_CELL_DATA_CACHE_SIZE,
+                                           &cell_data, index, source);
+      CHECK(err);
 
-    const RCRule* current_rule = &rce_state.rcrules[index];
-    err = rce_verify_one_rule(&rce_state, &states, &input_states,
-                              &output_states, proof_mask, proof, current_rule);
+      RCDataType rc_data = make_RCData(&cell_data);
+      uint32_t item_id = rc_data.t->item_id(&rc_data);
+      if (item_id == RCDataUnionRule || item_id == RCDataUnionSortedList) {
+        CHECK2(rce_state->rcrules_count < MAX_RCRULES_COUNT,
+               ERROR_TOO_MANY_RCRULES);
+
+        RCRule current;
+        RCRuleType rule;
+        RCSortedListType list;
+        current.sorted_list = item_id == RCDataUnionSortedList;
+        current.list_sides = 0;
+        if (current.sorted_list) {
+          list = rc_data.t->as_RCSortedList(&rc_data);
+          current.flags = list.t->flags(&list);
+        } else {
+          rule = rc_data.t->as_RCRule(&rc_data);
+          current.flags = rule.t->flags(&rule);
+        }
+        if (rce_is_emergency_halt_mode(current.flags)) {
+          err = ERROR_RCE_EMERGENCY_HALT;
+          // the rest of RC graph can't make it pass, return immediately
+          goto exit;
+        }
+        err = rce_check_rcrules_count(rce_state, &current);
+        CHECK(err);
+
+        if (current.sorted_list) {
+          memset(current.smt_root, 0, SMT_KEY_BYTES);
+          Byte32VecType hashes = list.t->hashes(&list);
+          err = rce_search_sorted_list(rce_state, &hashes, current.flags,
+                                       &current.list_sides);
+          CHECK(err);
+        } else {
+          mol2_cursor_t smt_root = rule.t->smt_root(&rule);
+          uint32_t read_len =
+              mol2_read_at(&smt_root, current.smt_root, SMT_KEY_BYTES);
+          CHECK2(read_len == SMT_KEY_BYTES, ERROR_INVALID_MOL_FORMAT);
+        }
+
+        uint32_t start = rce_state->rcrules_count;
+        uint32_t cached_start = rce_state->cached_rcrules_count;
+        err = rce_append_rcrule(rce_state, &current);
+        CHECK(err);
+        rce_add_visited(rce_state, hash, start, cached_start, 0);
+        rce_update_height(frames, frames_count, 0);
+      } else if (item_id == RCDataUnionCellVec) {
+        memcpy(frame->hash, hash, BLAKE2B_BLOCK_SIZE);
+        frame->start = rce_state->rcrules_count;
+        frame->cached_start = rce_state->cached_rcrules_count;
+        frame->height = 0;
+        frame->next = 0;
+        frame->cell_vec = rc_data.t->as_RCCellVec(&rc_data);
+        frame->len = frame->cell_vec.t->len(&frame->cell_vec);
+        frames_count++;
+      } else {
+        CHECK2(false, ERROR_INVALID_MOL_FORMAT);
+      }
+    }
+
+    // go to the next RCData cell, the RCCellVec finished are popped
+    while (frames_count > 0) {
+      RceGatherFrame* top = &frames[frames_count - 1];
+      if (top->next < top->len) {
+        bool existing = false;
+        mol2_cursor_t item =
+            top->cell_vec.t->get(&top->cell_vec, top->next, &existing);
+        CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+        CHECK2(item.size == BLAKE2B_BLOCK_SIZE, ERROR_INVALID_MOL_FORMAT);
+
+        uint32_t read_len = mol2_read_at(&item, hash, sizeof(hash));
+        CHECK2(read_len == sizeof(hash), ERROR_INVALID_MOL_FORMAT);
+        top->next++;
+        break;
+      }
+      rce_add_visited(rce_state, top->hash, top->start, top->cached_start,
+                      top->height);
+      frames_count--;
+      rce_update_height(frames, frames_count, top->height);
+    }
+    if (frames_count == 0) break;
+  }
+
+  err = 0;
+exit:
+  return err;
+}
+
+// the RceState with its lock hash buffers and the cell index
+static int rce_new_state(RceState** state) {
+  int err = 0;
+  RceState* rce_state = arena_alloc(sizeof(RceState));
+  CHECK2(rce_state != NULL, ERROR_NOT_ENOUGH_BUFF);
+  rce_init_state(rce_state);
+
+  uint32_t entries_size = MAX_LOCK_SCRIPT_HASH_COUNT * sizeof(smt_pair_t);
+  smt_pair_t* entries = arena_alloc(entries_size);
+  smt_pair_t* view_entries = arena_alloc(entries_size);
+  CHECK2(entries != NULL && view_entries != NULL, ERROR_NOT_ENOUGH_BUFF);
+  smt_state_init(&rce_state->states, entries, MAX_LOCK_SCRIPT_HASH_COUNT);
+  smt_state_init(&rce_state->view_states, view_entries,
+                 MAX_LOCK_SCRIPT_HASH_COUNT);
+
+  rce_build_cell_index(&rce_state->cell_index,
+                       rce_state->rcrules_in_input_cell);
+  *state = rce_state;
+exit:
+  return err;
+}
+
+int rce_validate(int is_owner_mode, size_t extension_index, const uint8_t* args,
+                 size_t args_len) {
+  int err = 0;
+  uint32_t mark = arena_mark();
+  RceState* rce_state = NULL;
+
+  CHECK2(args_len == BLAKE2B_BLOCK_SIZE, ERROR_INVALID_MOL_FORMAT);
+  CHECK2(args != NULL, ERROR_INVALID_RCE_ARGS);
+  if (is_owner_mode) return 0;
+
+  if (g_rce_state == NULL) {
+    err = rce_new_state(&g_rce_state);
     CHECK(err);
+    // kept for the next RCE extensions
+    mark = arena_mark();
   }
+  rce_state = g_rce_state;
+  rce_begin_rcrules(rce_state);
+
+  // the proofs in witness are checked before any RCData cell is loaded
+  err = rce_get_proofs(extension_index, &rce_state->proofs);
+  CHECK(err);
+  uint32_t proof_len = rce_state->proofs.t->len(&rce_state->proofs);
+  rce_state->proofs_count = proof_len;
+
+  // every RCRule is verified while the RC graph is walked
+  rce_state->verify_rcrules = true;
+  err = rce_gather_rcrules(rce_state, args);
+  CHECK(err);
+
+  // count of proof should be same as size of RCRules with SMT
+  CHECK2(proof_len == rce_state->smt_rcrules_count,
+         ERROR_RCRULES_PROOFS_MISMATCHED);
 
-  if (rce_state.has_wl) {
-    if (rce_state.both_on_wl) {
+  if (rce_state->has_wl) {
+    if (rce_state->both_on_wl) {
       err = 0;
     } else {
-      if (rce_state.input_on_wl && rce_state.output_on_wl) {
+      if (rce_state->input_on_wl && rce_state->output_on_wl) {
         err = 0;
       } else {
         err = ERROR_NOT_ON_WHITE_LIST;
@@ -516,6 +1175,7 @@ int rce_validate(int is_owner_mode, size_t extension_index, const uint8_t* args,
   }
 
 exit:
+  arena_release(mark);
   return err;
 }
 
@@ -108,6 +108,72 @@ exit:
   return err;
 }
 
+static int read_hash(Byte32VecType *hashes, uint32_t index, uint8_t *hash) {
+  int err = 0;
+  bool existing = false;
+  mol2_cursor_t item = hashes->t->get(hashes, index, &existing);
+  CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+  uint32_t read_len = mol2_read_at(&item, hash, BLAKE2B_BLOCK_SIZE);
+  CHECK2(read_len == BLAKE2B_BLOCK_SIZE, ERROR_INVALID_MOL_FORMAT);
+exit:
+  return err;
+}
+
+// The hashes of RCSortedList must be in ascending order without duplicates, so
+// xUDT can look for a lock script hash by binary search. With append only, all
+// the hashes of input RCSortedList must be kept: both are sorted, they're
+// compared in one pass.
+static int validate_sorted_list(RCDataType *rc_data, bool append_only,
+                                bool has_input, RCDataType *input_rc_data) {
+  int err = 0;
+  RCSortedListType list = rc_data->t->as_RCSortedList(rc_data);
+  Byte32VecType hashes = list.t->hashes(&list);
+  uint32_t len = hashes.t->len(&hashes);
+
+  // the input is a RCSortedList too, append only keeps the type
+  bool check_append = append_only && has_input;
+  Byte32VecType old_hashes = {0};
+  uint32_t old_len = 0;
+  uint32_t old_index = 0;
+  uint8_t old_hash[BLAKE2B_BLOCK_SIZE];
+  if (check_append) {
+    RCSortedListType old_list =
+        input_rc_data->t->as_RCSortedList(input_rc_data);
+    old_hashes = old_list.t->hashes(&old_list);
+    old_len = old_hashes.t->len(&old_hashes);
+  }
+
+  uint8_t prev_hash[BLAKE2B_BLOCK_SIZE];
+  for (uint32_t i = 0; i < len; i++) {
+    uint8_t hash[BLAKE2B_BLOCK_SIZE];
+    err = read_hash(&hashes, i, hash);
+    CHECK(err);
+    if (i > 0 && memcmp(prev_hash, hash, BLAKE2B_BLOCK_SIZE) >= 0) {
+      return ERROR_UNSORTED_LIST;
+    }
+    if (old_index < old_len) {
+      err = read_hash(&old_hashes, old_index, old_hash);
+      CHECK(err);
+      int cmp = memcmp(old_hash, hash, BLAKE2B_BLOCK_SIZE);
+      if (cmp < 0) {
+        // the old hash is removed
+        return ERROR_APPEND_ONLY;
+      }
+      if (cmp == 0) {
+        old_index++;
+      }
+    }
+    memcpy(prev_hash, hash, BLAKE2B_BLOCK_SIZE);
+  }
+  if (old_index < old_len) {
+    return ERROR_APPEND_ONLY;
+  }
+
+  err = CKB_SUCCESS;
+exit:
+  return err;
+}
+
 #ifdef CKB_USE_SIM
 int simulator_main() {
 #else
@@ -146,27 +212,28 @@ int main() {
 
   uint8_t input_hash[SMT_KEY_BYTES];
   memset(input_hash, 0, SMT_KEY_BYTES);
-  bool has_input = false, input_is_rule = false;
+  bool has_input = false;
+  uint32_t input_item_id = 0;
+  // it's used again when the output is a RCSortedList
+  uint8_t input_data_buffer[MOL2_DATA_SOURCE_LEN(CACHE_SIZE)];
+  RCDataType input_rc_data;
 
   if (_ckb_has_type_id_cell(0, 1) == 1) {
     has_input = true;
-    uint8_t input_data_buffer[MOL2_DATA_SOURCE_LEN(CACHE_SIZE)];
     mol2_cursor_t input_cell_data;
     err = make_data_cursor(input_data_buffer, CACHE_SIZE, 0,
                            CKB_SOURCE_GROUP_INPUT, &input_cell_data);
     CHECK(err);
 
-    RCDataType rc_data = make_RCData(&input_cell_data);
-    uint32_t item_id = rc_data.t->item_id(&rc_data);
-    if (item_id == RCDataUnionRule) {
-      RCRuleType rule = rc_data.t->as_RCRule(&rc_data);
+    input_rc_data = make_RCData(&input_cell_data);
+    input_item_id = input_rc_data.t->item_id(&input_rc_data);
+    if (input_item_id == RCDataUnionRule) {
+      RCRuleType rule = input_rc_data.t->as_RCRule(&input_rc_data);
       mol2_cursor_t smt_root = rule.t->smt_root(&rule);
       uint32_t read = mol2_read_at(&smt_root, input_hash, SMT_KEY_BYTES);
       CHECK2(read == SMT_KEY_BYTES, ERROR_INVALID_MOL_FORMAT);
-      input_is_rule = true;
-    } else if (item_id == RCDataUnionCellVec) {
-      input_is_rule = false;
-    } else {
+    } else if (input_item_id != RCDataUnionCellVec &&
+               input_item_id != RCDataUnionSortedList) {
       return ERROR_INVALID_MOL_FORMAT;
     }
   }
@@ -179,8 +246,13 @@ int main() {
 
   RCDataType rc_data = make_RCData(&output_cell_data);
   uint32_t item_id = rc_data.t->item_id(&rc_data);
+  // what is appended can't be told across types, so append only keeps the type
+  if (append_only && has_input && input_item_id != item_id) {
+    return ERROR_APPEND_ONLY;
+  }
   if (item_id == RCDataUnionRule) {
-    if (((flags & FLAG_FREEZE_TYPE) != 0) && (has_input) && (!input_is_rule)) {
+    if (((flags & FLAG_FREEZE_TYPE) != 0) && (has_input) &&
+        (input_item_id != RCDataUnionRule)) {
       return ERROR_TYPE_FREEZED;
     }
     RCRuleType rule = rc_data.t->as_RCRule(&rc_data);
@@ -279,8 +351,8 @@ int main() {
         mol2_read_at(&proof_cursor, proof, MAX_PROOF_LENGTH);
     CHECK2(proof_length == proof_cursor.size, ERROR_INVALID_MOL_FORMAT);
 
-    smt_state_normalize(&states);
-    smt_state_normalize(&old_states);
+    rce_state_normalize(&states);
+    rce_state_normalize(&old_states);
 
     // First validate old values & proof are correct
     err = smt_verify(input_hash, &old_states, proof, proof_length);
@@ -289,7 +361,8 @@ int main() {
     err = smt_verify(output_hash, &states, proof, proof_length);
     CHECK2(err == 0, ERROR_SMT_VERIFY_FAILED);
   } else if (item_id == RCDataUnionCellVec) {
-    if (((flags & FLAG_FREEZE_TYPE) != 0) && (has_input) && (input_is_rule)) {
+    if (((flags & FLAG_FREEZE_TYPE) != 0) && (has_input) &&
+        (input_item_id != RCDataUnionCellVec)) {
       return ERROR_TYPE_FREEZED;
     }
     RCCellVecType cell_vec = rc_data.t->as_RCCellVec(&rc_data);
@@ -304,6 +377,16 @@ int main() {
       CHECK2(read_len == sizeof(hash), ERROR_INVALID_MOL_FORMAT);
     }
 
+  } else if (item_id == RCDataUnionSortedList) {
+    if (((flags & FLAG_FREEZE_TYPE) != 0) && (has_input) &&
+        (input_item_id != RCDataUnionSortedList)) {
+      return ERROR_TYPE_FREEZED;
+    }
+    err = validate_sorted_list(&rc_data, append_only, has_input,
+                               &input_rc_data);
+    if (err != CKB_SUCCESS) {
+      return err;
+    }
   } else {
     return ERROR_INVALID_MOL_FORMAT;
   }
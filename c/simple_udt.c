@@ -27,6 +27,17 @@
 #define BLAKE2B_BLOCK_SIZE 32
 #define SCRIPT_SIZE 32768
 
+// Script is a molecule table of 3 fields: code_hash (32 bytes), hash_type (1
+// byte) and args (Bytes, a 4 bytes length then the content). The header is the
+// total size followed by the offsets of fields. With 32 bytes args, the whole
+// script is 85 bytes, and the layout is fixed.
+#define SCRIPT_FIELD_COUNT 3
+#define SCRIPT_HEADER_SIZE (MOL_NUM_T_SIZE * (SCRIPT_FIELD_COUNT + 1))
+#define SCRIPT_HASH_TYPE_OFFSET (SCRIPT_HEADER_SIZE + 32)
+#define SCRIPT_ARGS_OFFSET (SCRIPT_HASH_TYPE_OFFSET + 1)
+#define SCRIPT_ARGS_BYTES_OFFSET (SCRIPT_ARGS_OFFSET + MOL_NUM_T_SIZE)
+#define OWNER_SCRIPT_SIZE (SCRIPT_ARGS_BYTES_OFFSET + BLAKE2B_BLOCK_SIZE)
+
 // Common error codes that might be returned by the script.
 #define ERROR_ARGUMENTS_LEN -1
 #define ERROR_ENCODING -2
@@ -40,9 +51,11 @@ typedef unsigned __int128 uint128_t;
 
 int main() {
   // First, let's load current running script, so we can extract owner lock
-  // script hash from script args.
-  unsigned char script[SCRIPT_SIZE];
-  uint64_t len = SCRIPT_SIZE;
+  // script hash from script args. Only the first OWNER_SCRIPT_SIZE bytes are
+  // needed: if the script is longer, the args can't be 32 bytes. The syscall
+  // still reports the full size in `len`.
+  uint8_t script[OWNER_SCRIPT_SIZE];
+  uint64_t len = OWNER_SCRIPT_SIZE;
   int ret = ckb_load_script(script, &len, 0);
   if (ret != CKB_SUCCESS) {
     return ERROR_SYSCALL;
@@ -50,19 +63,25 @@ int main() {
   if (len > SCRIPT_SIZE) {
     return ERROR_SCRIPT_TOO_LONG;
   }
-  mol_seg_t script_seg;
-  script_seg.ptr = (uint8_t *)script;
-  script_seg.size = len;
 
-  if (MolReader_Script_verify(&script_seg, false) != MOL_OK) {
+  // Instead of a full MolReader_Script_verify, only the header this script
+  // relies on is checked: the total size and the offsets of the 3 fields,
+  // which must be exactly the ones of a script with 32 bytes args.
+  if (len < SCRIPT_HEADER_SIZE) {
     return ERROR_ENCODING;
   }
-
-  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
-  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
-  if (args_bytes_seg.size != BLAKE2B_BLOCK_SIZE) {
+  if (mol_unpack_number(script) != len ||
+      mol_unpack_number(script + MOL_NUM_T_SIZE) != SCRIPT_HEADER_SIZE ||
+      mol_unpack_number(script + MOL_NUM_T_SIZE * 2) !=
+          SCRIPT_HASH_TYPE_OFFSET ||
+      mol_unpack_number(script + MOL_NUM_T_SIZE * 3) != SCRIPT_ARGS_OFFSET) {
+    return ERROR_ENCODING;
+  }
+  if (len != OWNER_SCRIPT_SIZE ||
+      mol_unpack_number(script + SCRIPT_ARGS_OFFSET) != BLAKE2B_BLOCK_SIZE) {
     return ERROR_ARGUMENTS_LEN;
   }
+  const uint8_t *owner_lock_hash = script + SCRIPT_ARGS_BYTES_OFFSET;
 
   // With owner lock script extracted, we will look through each input in the
   // current transaction to see if any unlocked cell uses owner lock.
@@ -91,7 +110,7 @@ int main() {
     if (len != BLAKE2B_BLOCK_SIZE) {
       return ERROR_ENCODING;
     }
-    if (memcmp(buffer, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) == 0) {
+    if (memcmp(buffer, owner_lock_hash, BLAKE2B_BLOCK_SIZE) == 0) {
       owner_mode = 1;
       break;
     }
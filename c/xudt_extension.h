@@ -0,0 +1,78 @@
+#ifndef XUDT_RCE_SIMULATOR_C_XUDT_EXTENSION_H_
+#define XUDT_RCE_SIMULATOR_C_XUDT_EXTENSION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Optional entry of an extension script, besides "validate". When a library
+exports "validate2", xUDT calls it instead of "validate" and passes the data it
+has already loaded, so the extension doesn't need to load it again via
+syscalls. Data which is only needed by some extensions is loaded on demand via
+the host API, at most once per run. Libraries only exporting "validate" keep
+working as before.
+
+All pointers are owned by xUDT. They're read-only and only valid during the
+call.
+ */
+#define XUDT_VALIDATE2_FUNC_NAME "validate2"
+#define XUDT_VALIDATE_CONTEXT_VERSION 1
+#define XUDT_HOST_API_VERSION 1
+
+// defined in blake2b.h
+struct blake2b_state__;
+
+/*
+Services implemented by xUDT which extensions can use instead of linking and
+loading their own copies.
+ */
+typedef struct XudtHostApi {
+  // XUDT_HOST_API_VERSION, functions are only appended in later versions
+  uint32_t version;
+  // blake2b with CKB personalization ("ckb-default-hash")
+  int (*blake2b_init)(struct blake2b_state__ *S, size_t outlen);
+  int (*blake2b_update)(struct blake2b_state__ *S, const void *in,
+                        size_t inlen);
+  int (*blake2b_final)(struct blake2b_state__ *S, void *out, size_t outlen);
+  // 32 bytes blake2b hash of "data"
+  int (*hash)(uint8_t *out, const uint8_t *data, size_t len);
+  // check if any cell from "source" has its "field" (CKB_CELL_FIELD_LOCK_HASH
+  // or CKB_CELL_FIELD_TYPE_HASH) equal to "hash". Lock hashes of inputs are
+  // looked up in the host's cache.
+  int (*find_cell_hash)(size_t source, size_t field, const uint8_t *hash,
+                        bool *found);
+  // sum of amounts in CKB_SOURCE_GROUP_INPUT and CKB_SOURCE_GROUP_OUTPUT
+  int (*load_group_amounts)(unsigned __int128 *input_amount,
+                            unsigned __int128 *output_amount);
+  // lock script hashes of all inputs, sorted and without duplicates. It fails
+  // if there are too many distinct lock scripts, find_cell_hash still works.
+  int (*load_input_lock_hashes)(const uint8_t **hashes, uint32_t *count);
+} XudtHostApi;
+
+typedef struct XudtValidateContext {
+  // XUDT_VALIDATE_CONTEXT_VERSION, fields are only appended in later versions
+  uint32_t version;
+  // same as the arguments of "validate"
+  int is_owner_mode;
+  size_t extension_index;
+  const uint8_t *args;
+  size_t args_len;
+  // args of current xUDT script
+  const uint8_t *xudt_args;
+  size_t xudt_args_len;
+  // raw extension data (ScriptVec) from xUDT args or witness. It's NULL when
+  // it's in witness and too big to be loaded as a whole,
+  // raw_extension_data_len is still set.
+  const uint8_t *raw_extension_data;
+  size_t raw_extension_data_len;
+  // read the extension_data at "index" from witness. The witness is parsed
+  // and cached by xUDT, same return values as other xUDT functions.
+  int (*load_extension_data)(uint32_t index, uint8_t *buff, uint32_t buff_len,
+                             uint32_t *out_len);
+  const XudtHostApi *host;
+} XudtValidateContext;
+
+typedef int (*ValidateFunc2Type)(const XudtValidateContext *ctx);
+
+#endif  // XUDT_RCE_SIMULATOR_C_XUDT_EXTENSION_H_
@@ -9,7 +9,40 @@
 #endif
 int ckb_exit(signed char);
 
+/*
+xUDT is built into several variants from this file, by the policy switches
+below (see Makefile):
+
+- XUDT_ENABLE_DLOPEN: extension scripts loaded via ckb_dlopen2, with the code
+  buffer they need.
+- XUDT_ENABLE_RCE: the built-in Regulation Compliance Extension.
+- XUDT_PAIRED_AMOUNTS: xins, the amounts of group input and output cells at the
+  same index must be equal, even in owner mode.
+
+Without dlopen, RCE and extra built-in extensions (xudt_plain), only plain xUDT
+(flags = 0) is supported: the paths of extension scripts are not compiled in,
+and neither are their buffers. Enhanced owner mode (an owner script in
+witness) doesn't exist in xudt_plain either, so a transaction with flags = 0
+can't be unlocked by an owner script there, unlike xudt. Owner mode by input
+lock or type hash works the same.
+ */
+#ifndef XUDT_ENABLE_DLOPEN
+#define XUDT_ENABLE_DLOPEN 1
+#endif
+#ifndef XUDT_ENABLE_RCE
+#define XUDT_ENABLE_RCE 1
+#endif
+#ifndef XUDT_PAIRED_AMOUNTS
+#define XUDT_PAIRED_AMOUNTS 0
+#endif
+#if XUDT_ENABLE_DLOPEN || XUDT_ENABLE_RCE || defined(XUDT_EXTRA_BUILTINS_FILE)
+#define XUDT_ENABLE_EXTENSIONS 1
+#else
+#define XUDT_ENABLE_EXTENSIONS 0
+#endif
+
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "blake2b.h"
@@ -22,24 +55,35 @@ int ckb_exit(signed char);
 #include "ckb_syscall_xudt_sim.h"
 #define xudt_printf printf
 #else
+#if XUDT_ENABLE_DLOPEN
 // it will be re-defined in ckb_dlfcn.h
 #undef MAX
 #undef MIN
 #include "ckb_dlfcn.h"
+#endif
 #include "ckb_syscalls.h"
 #define xudt_printf(x, ...) (void)0
 #endif
 
 #define BLAKE160_SIZE 20
 #define SCRIPT_SIZE 32768
-#define RAW_EXTENSION_SIZE 65536
 #define EXPORTED_FUNC_NAME "validate"
+#if XUDT_ENABLE_DLOPEN
 // here we reserve a lot of memory for dynamic libraries. The enhanced owner
 // mode may also checked via dynamic library. It might consume much memory, e.g.
-// precomputed table (about 1 M) in secp256k1
-#define MAX_CODE_SIZE (1024 * 1800)
+// precomputed table (about 1 M) in secp256k1. The big buffers of owner mode and
+// RCE share the arena, the memory saved is given to it.
+#define MAX_CODE_SIZE (1024 * 1896)
+#else
+#define MAX_CODE_SIZE 0
+#endif
 #define FLAGS_SIZE 4
 #define MAX_LOCK_SCRIPT_HASH_COUNT 2048
+// extension scripts in raw extension data which is too big to be loaded as a
+// whole from witness. 64K of the smallest scripts is about 1150 of them.
+#define MAX_STREAMED_EXTENSION_COUNT 1024
+// amounts of group input cells kept for XUDT_PAIRED_AMOUNTS
+#define MAX_CACHED_AMOUNT_COUNT 1024
 
 #define OWNER_MODE_INPUT_TYPE_MASK 0x80000000
 #define OWNER_MODE_OUTPUT_TYPE_MASK 0x40000000
@@ -48,7 +92,36 @@ int ckb_exit(signed char);
   (OWNER_MODE_INPUT_TYPE_MASK | OWNER_MODE_OUTPUT_TYPE_MASK |                  \
    OWNER_MODE_INPUT_LOCK_NOT_MASK)
 
+// owner script (while the owner script runs, only its args are kept) and the
+// buffers of RCE (which can be the owner script) never overlap the others.
+// Nothing is allocated without extensions.
+#if XUDT_ENABLE_RCE
+#define ARENA_SIZE (ARENA_ROUND_UP(SCRIPT_SIZE) + RCE_ARENA_SIZE)
+#elif XUDT_ENABLE_EXTENSIONS
+#define ARENA_SIZE ARENA_ROUND_UP(SCRIPT_SIZE)
+#else
+#define ARENA_SIZE ARENA_ALIGN
+#endif
+
 #include "rce.h"
+#include "xudt_extension.h"
+
+// phases of xUDT, used to report the peak usage of arena
+typedef enum XudtPhase {
+  XudtPhaseArgs = 0,
+  XudtPhaseOwnerMode = 1,
+  XudtPhaseExtensions = 2,
+} XudtPhase;
+
+// CKB-VM has 4M memory. The code, small variables and the stack (without big
+// buffers) must fit in the rest.
+#define XUDT_MEMORY_SIZE (4 * 1024 * 1024)
+#define XUDT_RESERVED_MEMORY (1024 * 1024)
+_Static_assert(MAX_CODE_SIZE + ARENA_SIZE +
+                       SCRIPT_SIZE * (1 + XUDT_ENABLE_EXTENSIONS) +
+                       MAX_LOCK_SCRIPT_HASH_COUNT * BLAKE2B_BLOCK_SIZE <=
+                   XUDT_MEMORY_SIZE - XUDT_RESERVED_MEMORY,
+               "not enough memory for the stack");
 
 // global variables, type definitions, etc
 
@@ -56,11 +129,16 @@ int ckb_exit(signed char);
 typedef unsigned __int128 uint128_t;
 
 uint8_t g_script[SCRIPT_SIZE] = {0};
-uint8_t g_raw_extension_data[RAW_EXTENSION_SIZE] = {0};
+#if XUDT_ENABLE_EXTENSIONS
+// one extension script of raw extension data, copied out of witness
+uint8_t g_extension_script[SCRIPT_SIZE] = {0};
+#endif
 WitnessArgsType g_witness_args;
 
+#if XUDT_ENABLE_DLOPEN
 uint8_t g_code_buff[MAX_CODE_SIZE] __attribute__((aligned(RISCV_PGSIZE)));
 uint32_t g_code_used = 0;
+#endif
 
 /*
 is_owner_mode indicates if current xUDT is unlocked via owner mode(as
@@ -74,6 +152,12 @@ consider successful.
 typedef int (*ValidateFuncType)(int is_owner_mode, size_t extension_index,
                                 const uint8_t *args, size_t args_len);
 
+// the entries of an extension, "validate2" is optional, see xudt_extension.h
+typedef struct ValidateFunc {
+  ValidateFuncType validate;
+  ValidateFunc2Type validate2;
+} ValidateFunc;
+
 typedef enum XUDTFlags {
   XUDTFlagsPlain = 0,
   XUDTFlagsInArgs = 1,
@@ -87,33 +171,353 @@ typedef enum XUDTValidateFuncCategory {
 
 uint8_t RCE_HASH[32] = {1};
 
-// functions
-int load_validate_func(uint8_t *g_code_buff, uint32_t *g_code_used,
-                       const uint8_t *hash, uint8_t hash_type,
-                       ValidateFuncType *func, XUDTValidateFuncCategory *cat) {
+// Per-run snapshot of the transaction data shared by the validation phases.
+// Every part is loaded by one pass of syscalls the first time it's required,
+// later phases read from here instead of going back to the VM. Type hashes are
+// only consumed once (by owner mode checking) so they are not kept.
+//
+// Input lock hashes are kept sorted and unique: many inputs usually share the
+// same lock, so the limit MAX_LOCK_SCRIPT_HASH_COUNT applies to distinct lock
+// hashes only, not to the number of inputs. Beyond that limit, or when there
+// are so many distinct ones that compacting the buffer frees less than a
+// quarter of it, lookups fall back to scanning the inputs.
+#define MIN_FREED_LOCK_HASH_COUNT (MAX_LOCK_SCRIPT_HASH_COUNT / 4)
+#define TX_CTX_INPUT_LOCK_HASHES 0x1
+#define TX_CTX_GROUP_AMOUNTS 0x2
+#define TX_CTX_WITNESS_INDEX 0x4
+// too many distinct input locks to keep
+#define TX_CTX_TOO_MANY_LOCKS 0x8
+
+typedef struct XudtTxContext {
+  uint32_t loaded;
+  uint32_t input_lock_hashes_count;
+  uint8_t input_lock_hashes[MAX_LOCK_SCRIPT_HASH_COUNT * BLAKE2B_BLOCK_SIZE];
+  uint128_t group_input_amount;
+  uint128_t group_output_amount;
+#if XUDT_PAIRED_AMOUNTS
+  // count of group input cells and the amounts of first ones
+  uint32_t group_input_count;
+  uint128_t group_input_amounts[MAX_CACHED_AMOUNT_COUNT];
+  // any group output cell with different amount than the input at same index
+  bool amounts_mismatched;
+#endif
+} XudtTxContext;
+
+XudtTxContext g_tx_ctx;
+
+// scan the cells for a hash field equal to "hash", stop at the first match
+int scan_cell_hash(size_t source, size_t field, const uint8_t *hash,
+                   bool *found) {
   int err = 0;
-  void *handle = NULL;
-  size_t consumed_size = 0;
+  size_t i = 0;
+  uint8_t buffer[BLAKE2B_BLOCK_SIZE];
+
+  *found = false;
+  while (1) {
+    uint64_t len = BLAKE2B_BLOCK_SIZE;
+    err = ckb_checked_load_cell_by_field(buffer, &len, 0, i, source, field);
+    if (err == CKB_INDEX_OUT_OF_BOUND) {
+      err = 0;
+      break;
+    }
+    if (err == CKB_ITEM_MISSING) {
+      i += 1;
+      err = 0;
+      continue;
+    }
+    CHECK(err);
+    if (memcmp(buffer, hash, BLAKE2B_BLOCK_SIZE) == 0) {
+      *found = true;
+      break;
+    }
+    i += 1;
+  }
+
+exit:
+  return err;
+}
+
+// the simulator runs main several times in one process
+void tx_ctx_reset(void) { g_tx_ctx.loaded = 0; }
+
+static int compare_hash(const void *a, const void *b) {
+  return memcmp(a, b, BLAKE2B_BLOCK_SIZE);
+}
+
+// sort hashes and remove the duplicated ones, return the new count
+static uint32_t sort_unique_hashes(uint8_t *hashes, uint32_t count) {
+  if (count == 0) return 0;
+  qsort(hashes, count, BLAKE2B_BLOCK_SIZE, compare_hash);
+  uint32_t unique = 1;
+  for (uint32_t i = 1; i < count; i++) {
+    uint8_t *last = &hashes[(unique - 1) * BLAKE2B_BLOCK_SIZE];
+    uint8_t *curr = &hashes[i * BLAKE2B_BLOCK_SIZE];
+    if (memcmp(last, curr, BLAKE2B_BLOCK_SIZE) != 0) {
+      if (unique != i) {
+        memcpy(&hashes[unique * BLAKE2B_BLOCK_SIZE], curr, BLAKE2B_BLOCK_SIZE);
+      }
+      unique += 1;
+    }
+  }
+  return unique;
+}
+
+int tx_ctx_load_input_lock_hashes(void) {
+  int err = 0;
+  if (g_tx_ctx.loaded & TX_CTX_INPUT_LOCK_HASHES) return 0;
+  if (g_tx_ctx.loaded & TX_CTX_TOO_MANY_LOCKS) return ERROR_TOO_MANY_LOCK;
 
-  if (memcmp(RCE_HASH, hash, 32) == 0 && hash_type == 1) {
-    *cat = CateRce;
-    *func = rce_validate;
+  uint32_t count = 0;
+  size_t i = 0;
+  while (1) {
+    uint8_t buffer[BLAKE2B_BLOCK_SIZE];
+    uint64_t len = BLAKE2B_BLOCK_SIZE;
+    err = ckb_checked_load_cell_by_field(buffer, &len, 0, i, CKB_SOURCE_INPUT,
+                                         CKB_CELL_FIELD_LOCK_HASH);
+    if (err == CKB_INDEX_OUT_OF_BOUND) {
+      err = 0;
+      break;
+    }
+    CHECK(err);
+    if (count == MAX_LOCK_SCRIPT_HASH_COUNT) {
+      // compact the collected hashes before giving up. Every compaction must
+      // free MIN_FREED_LOCK_HASH_COUNT slots, so the buffer is sorted once
+      // per MIN_FREED_LOCK_HASH_COUNT inputs at most.
+      count = sort_unique_hashes(g_tx_ctx.input_lock_hashes, count);
+      if (MAX_LOCK_SCRIPT_HASH_COUNT - count < MIN_FREED_LOCK_HASH_COUNT) {
+        g_tx_ctx.loaded |= TX_CTX_TOO_MANY_LOCKS;
+        CHECK2(false, ERROR_TOO_MANY_LOCK);
+      }
+    }
+    memcpy(&g_tx_ctx.input_lock_hashes[count * BLAKE2B_BLOCK_SIZE], buffer,
+           BLAKE2B_BLOCK_SIZE);
+    count += 1;
+    i += 1;
+  }
+  g_tx_ctx.input_lock_hashes_count =
+      sort_unique_hashes(g_tx_ctx.input_lock_hashes, count);
+  g_tx_ctx.loaded |= TX_CTX_INPUT_LOCK_HASHES;
+
+exit:
+  return err;
+}
+
+// binary search in the sorted input lock hashes
+int tx_ctx_has_input_lock_hash(const uint8_t *hash, bool *found) {
+  int err = tx_ctx_load_input_lock_hashes();
+  if (err == ERROR_TOO_MANY_LOCK) {
+    return scan_cell_hash(CKB_SOURCE_INPUT, CKB_CELL_FIELD_LOCK_HASH, hash,
+                          found);
+  }
+  if (err != 0) return err;
+
+  *found = bsearch(hash, g_tx_ctx.input_lock_hashes,
+                   g_tx_ctx.input_lock_hashes_count, BLAKE2B_BLOCK_SIZE,
+                   compare_hash) != NULL;
+  return 0;
+}
+
+#if XUDT_PAIRED_AMOUNTS
+// Group input amounts are kept while they're summed, then every group output
+// is compared with the input at same index until the first mismatch. Inputs
+// beyond MAX_CACHED_AMOUNT_COUNT are loaded again.
+static int tx_ctx_pair_amount(size_t source, size_t index, uint128_t amount) {
+  int err = 0;
+  if (source == CKB_SOURCE_GROUP_INPUT) {
+    if (index < MAX_CACHED_AMOUNT_COUNT) {
+      g_tx_ctx.group_input_amounts[index] = amount;
+    }
+    g_tx_ctx.group_input_count = index + 1;
     return 0;
   }
+  if (g_tx_ctx.amounts_mismatched || index >= g_tx_ctx.group_input_count) {
+    return 0;
+  }
+  uint128_t input_amount = 0;
+  if (index < MAX_CACHED_AMOUNT_COUNT) {
+    input_amount = g_tx_ctx.group_input_amounts[index];
+  } else {
+    uint64_t len = 16;
+    err = ckb_load_cell_data((uint8_t *)&input_amount, &len, 0, index,
+                             CKB_SOURCE_GROUP_INPUT);
+    CHECK(err);
+    CHECK2(len >= 16, ERROR_ENCODING);
+  }
+  g_tx_ctx.amounts_mismatched = input_amount != amount;
+
+exit:
+  return err;
+}
+#endif
+
+static int tx_ctx_sum_amounts(size_t source, uint128_t *amount) {
+  int err = 0;
+  size_t i = 0;
+  *amount = 0;
+  while (1) {
+    uint128_t current_amount = 0;
+    uint64_t len = 16;
+    // The implementation here does not require that the transaction only
+    // contains UDT cells for the current UDT type. It's perfectly fine to mix
+    // the cells for multiple different types of UDT together in one
+    // transaction. But that also means we need a way to tell one UDT type from
+    // another UDT type. The trick is in the `CKB_SOURCE_GROUP_INPUT` and
+    // `CKB_SOURCE_GROUP_OUTPUT` values used here. When using them as the
+    // source part of the syscall, the syscall would only iterate through cells
+    // with the same script as the current running script. Since different UDT
+    // types will naturally have different script(the args part will be
+    // different), we can be sure here that this loop would only iterate
+    // through UDTs that are of the same type as the one identified by the
+    // current running script.
+    //
+    // A different trick used here, is that our current implementation assumes
+    // that the amount of UDT is stored as unsigned 128-bit little endian
+    // integer in the first 16 bytes of cell data. Since RISC-V also uses little
+    // endian format, we can just read the first 16 bytes of cell data into
+    // `current_amount`, which is just an unsigned 128-bit integer in C. The
+    // memory layout of a C program will ensure that the value is set correctly.
+    err = ckb_load_cell_data((uint8_t *)&current_amount, &len, 0, i, source);
+    // When `CKB_INDEX_OUT_OF_BOUND` is reached, we know we have iterated
+    // through all cells of current type.
+    if (err == CKB_INDEX_OUT_OF_BOUND) {
+      err = 0;
+      break;
+    }
+    CHECK(err);
+    CHECK2(len >= 16, ERROR_ENCODING);
+    *amount += current_amount;
+    // Like any serious smart contract out there, we will need to check for
+    // overflows.
+    CHECK2(*amount >= current_amount, ERROR_OVERFLOWING);
+#if XUDT_PAIRED_AMOUNTS
+    err = tx_ctx_pair_amount(source, i, current_amount);
+    CHECK(err);
+#endif
+    i += 1;
+  }
 
-  CHECK2(MAX_CODE_SIZE > *g_code_used, ERROR_NOT_ENOUGH_BUFF);
-  err = ckb_dlopen2(hash, hash_type, &g_code_buff[*g_code_used],
-                    MAX_CODE_SIZE - *g_code_used, &handle, &consumed_size);
+exit:
+  return err;
+}
+
+int tx_ctx_load_group_amounts(void) {
+  int err = 0;
+  if (g_tx_ctx.loaded & TX_CTX_GROUP_AMOUNTS) return 0;
+#if XUDT_PAIRED_AMOUNTS
+  g_tx_ctx.group_input_count = 0;
+  g_tx_ctx.amounts_mismatched = false;
+#endif
+
+  err = tx_ctx_sum_amounts(CKB_SOURCE_GROUP_INPUT,
+                           &g_tx_ctx.group_input_amount);
   CHECK(err);
-  CHECK2(handle != NULL, ERROR_CANT_LOAD_LIB);
-  ASSERT(consumed_size % RISCV_PGSIZE == 0);
-  *g_code_used += consumed_size;
+  err = tx_ctx_sum_amounts(CKB_SOURCE_GROUP_OUTPUT,
+                           &g_tx_ctx.group_output_amount);
+  CHECK(err);
+  g_tx_ctx.loaded |= TX_CTX_GROUP_AMOUNTS;
+
+exit:
+  return err;
+}
 
-  *func = (ValidateFuncType)ckb_dlsym(handle, EXPORTED_FUNC_NAME);
-  CHECK2(*func != NULL, ERROR_CANT_FIND_SYMBOL);
+#if XUDT_ENABLE_EXTENSIONS
+#if XUDT_ENABLE_DLOPEN
+// Libraries loaded in current run, keyed by (code_hash, hash_type). The same
+// library referenced by several extensions or by the owner script is only
+// loaded once.
+#define MAX_LOADED_LIB_COUNT 32
+typedef struct LoadedLib {
+  uint8_t code_hash[32];
+  uint8_t hash_type;
+  ValidateFunc func;
+} LoadedLib;
+
+LoadedLib g_loaded_libs[MAX_LOADED_LIB_COUNT];
+uint32_t g_loaded_libs_count = 0;
+#endif
+
+// Built-in extensions are linked into xUDT and dispatched directly, without
+// ckb_dlopen2. A deployment can compile in its own ones by defining
+// XUDT_EXTRA_BUILTINS_FILE as a file with more initializers of this table,
+// e.g. {SUPPLY_CAP_HASH, 1, CateNormal, supply_cap_validate},
+typedef struct BuiltinExtension {
+  const uint8_t *code_hash;
+  uint8_t hash_type;
+  XUDTValidateFuncCategory cat;
+  ValidateFuncType validate;
+} BuiltinExtension;
+
+const BuiltinExtension g_builtin_extensions[] = {
+#if XUDT_ENABLE_RCE
+    {RCE_HASH, 1, CateRce, rce_validate},
+#endif
+#ifdef XUDT_EXTRA_BUILTINS_FILE
+#include XUDT_EXTRA_BUILTINS_FILE
+#endif
+};
+
+// functions
+const BuiltinExtension *find_builtin_extension(const uint8_t *hash,
+                                               uint8_t hash_type) {
+  size_t count = sizeof(g_builtin_extensions) / sizeof(BuiltinExtension);
+  for (size_t i = 0; i < count; i++) {
+    const BuiltinExtension *ext = &g_builtin_extensions[i];
+    if (ext->hash_type == hash_type && memcmp(ext->code_hash, hash, 32) == 0) {
+      return ext;
+    }
+  }
+  return NULL;
+}
+
+int load_validate_func(const uint8_t *hash, uint8_t hash_type,
+                       ValidateFunc *func, XUDTValidateFuncCategory *cat) {
+  int err = 0;
+  const BuiltinExtension *builtin = find_builtin_extension(hash, hash_type);
+  if (builtin != NULL) {
+    *cat = builtin->cat;
+    func->validate = builtin->validate;
+    func->validate2 = NULL;
+    return 0;
+  }
 
   *cat = CateNormal;
+#if XUDT_ENABLE_DLOPEN
+  void *handle = NULL;
+  size_t consumed_size = 0;
+  for (uint32_t i = 0; i < g_loaded_libs_count; i++) {
+    LoadedLib *lib = &g_loaded_libs[i];
+    if (lib->hash_type == hash_type && memcmp(lib->code_hash, hash, 32) == 0) {
+      *func = lib->func;
+      return 0;
+    }
+  }
+
+  CHECK2(MAX_CODE_SIZE > g_code_used, ERROR_NOT_ENOUGH_BUFF);
+  err = ckb_dlopen2(hash, hash_type, &g_code_buff[g_code_used],
+                    MAX_CODE_SIZE - g_code_used, &handle, &consumed_size);
+  CHECK(err);
+  CHECK2(handle != NULL, ERROR_CANT_LOAD_LIB);
+  ASSERT(consumed_size % RISCV_PGSIZE == 0);
+  g_code_used += consumed_size;
+
+  func->validate2 =
+      (ValidateFunc2Type)ckb_dlsym(handle, XUDT_VALIDATE2_FUNC_NAME);
+  func->validate = (ValidateFuncType)ckb_dlsym(handle, EXPORTED_FUNC_NAME);
+  CHECK2(func->validate != NULL || func->validate2 != NULL,
+         ERROR_CANT_FIND_SYMBOL);
+
+  if (g_loaded_libs_count < MAX_LOADED_LIB_COUNT) {
+    LoadedLib *lib = &g_loaded_libs[g_loaded_libs_count];
+    memcpy(lib->code_hash, hash, 32);
+    lib->hash_type = hash_type;
+    lib->func = *func;
+    g_loaded_libs_count += 1;
+  }
   err = 0;
+#else
+  // only built-in extensions
+  CHECK2(false, ERROR_CANT_LOAD_LIB);
+#endif
 exit:
   return err;
 }
@@ -129,6 +533,7 @@ int verify_script_vec(uint8_t *ptr, uint32_t size, uint32_t *real_size) {
 exit:
   return err;
 }
+#endif  // XUDT_ENABLE_EXTENSIONS
 
 static uint32_t read_from_witness(uintptr_t arg[], uint8_t *ptr, uint32_t len,
                                   uint32_t offset) {
@@ -193,31 +598,98 @@ exit:
   return err;
 }
 
-int get_extension_data(uint32_t index, uint8_t *buff, uint32_t buff_len,
-                       uint32_t *out_len) {
+// Offsets of the XudtWitnessInput fields. The witness is navigated only once
+// per run, all accessors below read through these cursors afterwards. They
+// share the cache of g_witness_data_source, so make_cursor_from_witness must
+// not be called again while they are in use.
+#define MAX_INDEXED_EXTENSION_DATA 64
+typedef struct XudtWitnessIndex {
+  bool has_owner_script;
+  ScriptType owner_script;
+  BytesOptType owner_signature;
+  ScriptVecOptType raw_extension_data;
+  BytesVecType extension_data_vec;
+  uint32_t extension_data_count;
+  // cursors of the first MAX_INDEXED_EXTENSION_DATA items of extension_data
+  mol2_cursor_t extension_data[MAX_INDEXED_EXTENSION_DATA];
+} XudtWitnessIndex;
+
+XudtWitnessIndex g_witness_index;
+
+int load_witness_index(void) {
   int err = 0;
+  if (g_tx_ctx.loaded & TX_CTX_WITNESS_INDEX) return 0;
+
   bool use_input_type = true;
   err = make_cursor_from_witness(&g_witness_args, &use_input_type);
   CHECK(err);
 
   BytesOptType input;
-  if (use_input_type)
+  if (use_input_type) {
     input = g_witness_args.t->input_type(&g_witness_args);
-  else
+  } else {
     input = g_witness_args.t->output_type(&g_witness_args);
-
+  }
   CHECK2(!input.t->is_none(&input), ERROR_INVALID_MOL_FORMAT);
 
   mol2_cursor_t bytes = input.t->unwrap(&input);
   // convert Bytes to XudtWitnessInputType
   XudtWitnessInputType witness_input = make_XudtWitnessInput(&bytes);
-  BytesVecType extension_data_vec =
-      witness_input.t->extension_data(&witness_input);
+  XudtWitnessIndex *index = &g_witness_index;
+
+  ScriptOptType owner_script = witness_input.t->owner_script(&witness_input);
+  index->has_owner_script = !owner_script.t->is_none(&owner_script);
+  if (index->has_owner_script) {
+    index->owner_script = owner_script.t->unwrap(&owner_script);
+  }
+  index->owner_signature = witness_input.t->owner_signature(&witness_input);
+  index->raw_extension_data =
+      witness_input.t->raw_extension_data(&witness_input);
+  index->extension_data_vec = witness_input.t->extension_data(&witness_input);
+
+  BytesVecType *vec = &index->extension_data_vec;
+  index->extension_data_count = vec->t->len(vec);
+  uint32_t indexed_count = index->extension_data_count;
+  if (indexed_count > MAX_INDEXED_EXTENSION_DATA) {
+    indexed_count = MAX_INDEXED_EXTENSION_DATA;
+  }
+  for (uint32_t i = 0; i < indexed_count; i++) {
+    bool existing = false;
+    index->extension_data[i] = vec->t->get(vec, i, &existing);
+    CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+  }
+  g_tx_ctx.loaded |= TX_CTX_WITNESS_INDEX;
 
-  bool existing = false;
-  mol2_cursor_t extension_data =
-      extension_data_vec.t->get(&extension_data_vec, index, &existing);
-  CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+exit:
+  return err;
+}
+
+int get_extension_data_cursor(uint32_t index, mol2_cursor_t *cur) {
+  int err = 0;
+  err = load_witness_index();
+  CHECK(err);
+  CHECK2(index < g_witness_index.extension_data_count,
+         ERROR_INVALID_MOL_FORMAT);
+
+  if (index < MAX_INDEXED_EXTENSION_DATA) {
+    *cur = g_witness_index.extension_data[index];
+  } else {
+    bool existing = false;
+    BytesVecType *vec = &g_witness_index.extension_data_vec;
+    *cur = vec->t->get(vec, index, &existing);
+    CHECK2(existing, ERROR_INVALID_MOL_FORMAT);
+  }
+
+exit:
+  return err;
+}
+
+int get_extension_data(uint32_t index, uint8_t *buff, uint32_t buff_len,
+                       uint32_t *out_len) {
+  int err = 0;
+  mol2_cursor_t extension_data;
+  err = get_extension_data_cursor(index, &extension_data);
+  CHECK(err);
   CHECK2(buff_len >= extension_data.size, ERROR_INVALID_MOL_FORMAT);
 
   *out_len = mol2_read_at(&extension_data, buff, buff_len);
@@ -230,99 +702,332 @@ exit:
 
 int get_owner_script(uint8_t *buff, uint32_t buff_len, uint32_t *out_len) {
   int err = 0;
-  bool use_input_type = true;
-  err = make_cursor_from_witness(&g_witness_args, &use_input_type);
+  err = load_witness_index();
   CHECK(err);
-  BytesOptType input = use_input_type
-                           ? g_witness_args.t->input_type(&g_witness_args)
-                           : g_witness_args.t->output_type(&g_witness_args);
-  CHECK2(!input.t->is_none(&input), ERROR_INVALID_MOL_FORMAT);
+  CHECK2(g_witness_index.has_owner_script, ERROR_INVALID_MOL_FORMAT);
 
-  mol2_cursor_t bytes = input.t->unwrap(&input);
-  // convert Bytes to XudtWitnessInputType
-  XudtWitnessInputType witness_input = make_XudtWitnessInput(&bytes);
-  ScriptOptType owner_script = witness_input.t->owner_script(&witness_input);
-  CHECK2(!owner_script.t->is_none(&owner_script), ERROR_INVALID_MOL_FORMAT);
-  ScriptType owner_script2 = owner_script.t->unwrap(&owner_script);
-  *out_len = mol2_read_at(&owner_script2.cur, buff, buff_len);
-  CHECK2(*out_len == owner_script2.cur.size, ERROR_INVALID_MOL_FORMAT);
+  mol2_cursor_t *owner_script = &g_witness_index.owner_script.cur;
+  *out_len = mol2_read_at(owner_script, buff, buff_len);
+  CHECK2(*out_len == owner_script->size, ERROR_INVALID_MOL_FORMAT);
 
   err = 0;
 exit:
   return err;
 }
 
-// the *var_len may be bigger than real length of raw extension data
-int load_raw_extension_data(uint8_t **var_data, uint32_t *var_len) {
+// Raw extension data (ScriptVec). When it's in args, or it's in witness and
+// fits in g_extension_script, it's verified as a whole in memory. Otherwise
+// it's streamed once: it's hashed and verified in the same pass, the offsets
+// of extension scripts are kept and every extension script is copied out of
+// witness when it's needed.
+typedef struct ExtensionList {
+  bool in_witness;
+  uint32_t size;
+  uint32_t count;
+  // in memory
+  mol_seg_t seg;
+  // in witness
+  mol2_cursor_t cur;
+  const uint8_t *blake160_hash;
+} ExtensionList;
+
+#if XUDT_ENABLE_EXTENSIONS
+// offsets of the streamed extension scripts, the last one is the total size
+uint32_t g_extension_offsets[MAX_STREAMED_EXTENSION_COUNT + 1];
+
+// nothing is read here, it's done by check_extension_list after the cheap
+// checks
+int load_raw_extension_data(const uint8_t *blake160_hash,
+                            ExtensionList *list) {
   int err = 0;
-  bool use_input_type = true;
-  err = make_cursor_from_witness(&g_witness_args, &use_input_type);
+  err = load_witness_index();
   CHECK(err);
 
-  BytesOptType input;
-  if (use_input_type) {
-    input = g_witness_args.t->input_type(&g_witness_args);
-  } else {
-    input = g_witness_args.t->output_type(&g_witness_args);
-  }
+  mol2_cursor_t *script_vec = &g_witness_index.raw_extension_data.cur;
+  CHECK2(script_vec->size > 0, ERROR_INVALID_MOL_FORMAT);
 
-  CHECK2(!input.t->is_none(&input), ERROR_INVALID_MOL_FORMAT);
+  list->in_witness = true;
+  list->size = script_vec->size;
+  list->cur = *script_vec;
+  list->blake160_hash = blake160_hash;
 
-  struct mol2_cursor_t bytes = input.t->unwrap(&input);
-  // convert Bytes to XudtWitnessInputType
-  XudtWitnessInputType witness_input = make_XudtWitnessInput(&bytes);
-  ScriptVecOptType script_vec =
-      witness_input.t->raw_extension_data(&witness_input);
+  err = 0;
+exit:
+  return err;
+}
 
-  uint32_t read_len =
-      mol2_read_at(&script_vec.cur, g_raw_extension_data, RAW_EXTENSION_SIZE);
-  CHECK2(read_len == script_vec.cur.size, ERROR_INVALID_MOL_FORMAT);
+// read the raw extension data from "offset" into g_extension_script, as much
+// as it fits
+int read_extension_window(const ExtensionList *list, uint32_t offset,
+                          uint32_t *window_len) {
+  int err = 0;
+  uint32_t remain = list->size - offset;
+  uint32_t len = remain < SCRIPT_SIZE ? remain : SCRIPT_SIZE;
+  mol2_cursor_t window = mol2_slice_by_offset(&list->cur, offset, len);
+  uint32_t read_len = mol2_read_at(&window, g_extension_script, len);
+  CHECK2(read_len == len, ERROR_INVALID_MOL_FORMAT);
+  *window_len = len;
 
-  *var_data = g_raw_extension_data;
-  *var_len = read_len;
+  err = 0;
+exit:
+  return err;
+}
+
+// "rce_end" is set to the index of last RCE extension plus 1
+int verify_extension_script(uint32_t index, mol_seg_t script,
+                            uint32_t *rce_end) {
+  int err = 0;
+  CHECK2(MolReader_Script_verify(&script, false) == MOL_OK,
+         ERROR_INVALID_MOL_FORMAT);
+  mol_seg_t code_hash = MolReader_Script_get_code_hash(&script);
+  mol_seg_t hash_type = MolReader_Script_get_hash_type(&script);
+  const BuiltinExtension *builtin =
+      find_builtin_extension(code_hash.ptr, *(uint8_t *)hash_type.ptr);
+  if (builtin != NULL && builtin->cat == CateRce) {
+    *rce_end = index + 1;
+  }
 
   err = 0;
 exit:
   return err;
 }
 
-int check_owner_mode(size_t source, size_t field, mol_seg_t args_bytes_seg,
-                     int *owner_mode) {
+// same header checks as MolReader_ScriptVec_verify(compatible = true) on a
+// ScriptVec bigger than g_extension_script, which is used as a window. Every
+// byte is hashed once, in order. The extension scripts are collected into
+// g_extension_offsets and each one is verified strictly.
+int stream_extension_list(ExtensionList *list, blake2b_state *blake2b_ctx,
+                          uint32_t *rce_end) {
   int err = 0;
-  size_t i = 0;
-  uint8_t buffer[BLAKE2B_BLOCK_SIZE];
+  uint32_t window = 0;
+  uint32_t window_len = 0;
+  err = read_extension_window(list, window, &window_len);
+  CHECK(err);
+  // the header fits in window: there are enough bytes and a limited count
+  CHECK2(mol_unpack_number(g_extension_script) == list->size,
+         ERROR_INVALID_ARGS_FORMAT);
+  mol_num_t first_offset =
+      mol_unpack_number(g_extension_script + MOL_NUM_T_SIZE);
+  CHECK2(first_offset % MOL_NUM_T_SIZE == 0 &&
+             first_offset >= MOL_NUM_T_SIZE * 2,
+         ERROR_INVALID_ARGS_FORMAT);
+  list->count = first_offset / MOL_NUM_T_SIZE - 1;
+  CHECK2(list->count <= MAX_STREAMED_EXTENSION_COUNT, ERROR_NOT_ENOUGH_BUFF);
+  uint32_t prev = first_offset;
+  for (uint32_t i = 0; i < list->count; i++) {
+    mol_num_t offset =
+        mol_unpack_number(g_extension_script + MOL_NUM_T_SIZE * (i + 1));
+    CHECK2(offset >= prev && offset <= list->size, ERROR_INVALID_ARGS_FORMAT);
+    g_extension_offsets[i] = offset;
+    prev = offset;
+  }
+  g_extension_offsets[list->count] = list->size;
+  blake2b_update(blake2b_ctx, g_extension_script, first_offset);
+
+  for (uint32_t i = 0; i < list->count; i++) {
+    uint32_t start = g_extension_offsets[i];
+    uint32_t size = g_extension_offsets[i + 1] - start;
+    CHECK2(size <= SCRIPT_SIZE, ERROR_SCRIPT_TOO_LONG);
+    if (start + size > window + window_len) {
+      window = start;
+      err = read_extension_window(list, window, &window_len);
+      CHECK(err);
+    }
+    mol_seg_t script = {g_extension_script + start - window, size};
+    blake2b_update(blake2b_ctx, script.ptr, script.size);
+    err = verify_extension_script(i, script, rce_end);
+    CHECK(err);
+  }
 
-  while (1) {
-    uint64_t len = BLAKE2B_BLOCK_SIZE;
-    err = ckb_checked_load_cell_by_field(buffer, &len, 0, i, source, field);
-    if (err == CKB_INDEX_OUT_OF_BOUND) {
-      err = 0;
-      break;
+  err = 0;
+exit:
+  return err;
+}
+
+// The structure of all extension scripts is verified in one pass, before
+// dlopen or SMT work. When it's in witness, it's hashed in the same pass: the
+// structure is checked on the bytes being hashed, nothing is read twice.
+// "rce_end" is set to the index of last RCE extension plus 1, or 0 when there
+// is none.
+int check_extension_list(ExtensionList *list, uint32_t *rce_end) {
+  int err = 0;
+  *rce_end = 0;
+
+  if (list->in_witness) {
+    blake2b_state blake2b_ctx;
+    blake2b_init(&blake2b_ctx, BLAKE2B_BLOCK_SIZE);
+    if (list->size <= SCRIPT_SIZE) {
+      uint32_t window_len = 0;
+      err = read_extension_window(list, 0, &window_len);
+      CHECK(err);
+      blake2b_update(&blake2b_ctx, g_extension_script, window_len);
+      // it's in memory now, same as in args
+      list->in_witness = false;
+      list->seg.ptr = g_extension_script;
+      list->seg.size = window_len;
+      CHECK2(MolReader_ScriptVec_verify(&list->seg, true) == MOL_OK,
+             ERROR_INVALID_ARGS_FORMAT);
+      list->count = MolReader_ScriptVec_length(&list->seg);
+    } else {
+      err = stream_extension_list(list, &blake2b_ctx, rce_end);
+      CHECK(err);
     }
-    if (err == CKB_ITEM_MISSING) {
-      i += 1;
-      err = 0;
-      continue;
+    uint8_t hash[BLAKE2B_BLOCK_SIZE] = {0};
+    blake2b_final(&blake2b_ctx, hash, BLAKE2B_BLOCK_SIZE);
+    CHECK2(memcmp(list->blake160_hash, hash, BLAKE160_SIZE) == 0,
+           ERROR_HASH_MISMATCHED);
+    if (list->in_witness) {
+      return 0;
     }
+  }
+
+  for (uint32_t i = 0; i < list->count; i++) {
+    mol_seg_res_t res = MolReader_ScriptVec_get(&list->seg, i);
+    CHECK2(res.errno == 0, ERROR_INVALID_MOL_FORMAT);
+    err = verify_extension_script(i, res.seg, rce_end);
     CHECK(err);
-    if (args_bytes_seg.size >= BLAKE2B_BLOCK_SIZE &&
-        memcmp(buffer, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) == 0) {
-      *owner_mode = 1;
-      break;
-    }
-    i += 1;
+  }
+
+  err = 0;
+exit:
+  return err;
+}
+
+// get extension script at "index", it's verified by check_extension_list.
+// When it's streamed, it's copied into g_extension_script which is overwritten
+// by next call.
+int extension_list_get(const ExtensionList *list, uint32_t index,
+                       mol_seg_t *script) {
+  int err = 0;
+  CHECK2(index < list->count, ERROR_INVALID_MOL_FORMAT);
+
+  if (list->in_witness) {
+    uint32_t start = g_extension_offsets[index];
+    uint32_t size = g_extension_offsets[index + 1] - start;
+    mol2_cursor_t item = mol2_slice_by_offset(&list->cur, start, size);
+    uint32_t read_len = mol2_read_at(&item, g_extension_script, size);
+    CHECK2(read_len == size, ERROR_INVALID_MOL_FORMAT);
+    script->ptr = g_extension_script;
+    script->size = size;
+  } else {
+    mol_seg_res_t res = MolReader_ScriptVec_get(&list->seg, index);
+    CHECK2(res.errno == 0, ERROR_INVALID_MOL_FORMAT);
+    *script = res.seg;
+  }
+
+  err = 0;
+exit:
+  return err;
+}
+#endif  // XUDT_ENABLE_EXTENSIONS
+
+int check_owner_mode(size_t source, size_t field, mol_seg_t args_bytes_seg,
+                     int *owner_mode) {
+  int err = 0;
+  bool found = false;
+
+  if (args_bytes_seg.size < BLAKE2B_BLOCK_SIZE) {
+    return 0;
+  }
+  // use the snapshot if some earlier step has loaded it, otherwise a scan
+  // stopping at the first match is cheaper than collecting all the hashes
+  if (source == CKB_SOURCE_INPUT && field == CKB_CELL_FIELD_LOCK_HASH &&
+      (g_tx_ctx.loaded & TX_CTX_INPUT_LOCK_HASHES)) {
+    err = tx_ctx_has_input_lock_hash(args_bytes_seg.ptr, &found);
+  } else {
+    err = scan_cell_hash(source, field, args_bytes_seg.ptr, &found);
+  }
+  CHECK(err);
+  if (found) {
+    *owner_mode = 1;
   }
 
 exit:
   return err;
 }
 
+// args of current script, set by parse_args, point to g_script
+mol_seg_t g_args_bytes_seg;
+
+#if XUDT_ENABLE_EXTENSIONS
+#if XUDT_ENABLE_DLOPEN
+int host_hash(uint8_t *out, const uint8_t *data, size_t len) {
+  int err = blake2b(out, BLAKE2B_BLOCK_SIZE, data, len, NULL, 0);
+  return err == 0 ? 0 : ERROR_BLAKE2B_ERROR;
+}
+
+int host_find_cell_hash(size_t source, size_t field, const uint8_t *hash,
+                        bool *found) {
+  if (source == CKB_SOURCE_INPUT && field == CKB_CELL_FIELD_LOCK_HASH) {
+    return tx_ctx_has_input_lock_hash(hash, found);
+  }
+  return scan_cell_hash(source, field, hash, found);
+}
+
+int host_load_group_amounts(uint128_t *input_amount,
+                            uint128_t *output_amount) {
+  int err = tx_ctx_load_group_amounts();
+  if (err != 0) return err;
+  *input_amount = g_tx_ctx.group_input_amount;
+  *output_amount = g_tx_ctx.group_output_amount;
+  return 0;
+}
+
+int host_load_input_lock_hashes(const uint8_t **hashes, uint32_t *count) {
+  int err = tx_ctx_load_input_lock_hashes();
+  if (err != 0) return err;
+  *hashes = g_tx_ctx.input_lock_hashes;
+  *count = g_tx_ctx.input_lock_hashes_count;
+  return 0;
+}
+
+const XudtHostApi g_host_api = {
+    .version = XUDT_HOST_API_VERSION,
+    .blake2b_init = blake2b_init,
+    .blake2b_update = blake2b_update,
+    .blake2b_final = blake2b_final,
+    .hash = host_hash,
+    .find_cell_hash = host_find_cell_hash,
+    .load_group_amounts = host_load_group_amounts,
+    .load_input_lock_hashes = host_load_input_lock_hashes,
+};
+
+// raw extension data is set by main, the rest is filled per call
+XudtValidateContext g_validate_ctx;
+#endif
+
+int call_validate_func(const ValidateFunc *func, int is_owner_mode,
+                       size_t extension_index, const uint8_t *args,
+                       size_t args_len) {
+  if (func->validate2 == NULL) {
+    return func->validate(is_owner_mode, extension_index, args, args_len);
+  }
+#if XUDT_ENABLE_DLOPEN
+  XudtValidateContext *ctx = &g_validate_ctx;
+  ctx->version = XUDT_VALIDATE_CONTEXT_VERSION;
+  ctx->is_owner_mode = is_owner_mode;
+  ctx->extension_index = extension_index;
+  ctx->args = args;
+  ctx->args_len = args_len;
+  ctx->xudt_args = g_args_bytes_seg.ptr;
+  ctx->xudt_args_len = g_args_bytes_seg.size;
+  ctx->load_extension_data = get_extension_data;
+  ctx->host = &g_host_api;
+  return func->validate2(ctx);
+#else
+  // only libraries can export "validate2"
+  return ERROR_CANT_FIND_SYMBOL;
+#endif
+}
+
 int check_enhanced_owner_mode(int *owner_mode) {
   int err = 0;
-  uint8_t owner_script[SCRIPT_SIZE];
+  uint32_t mark = arena_mark();
   uint32_t owner_script_len = 0;
   uint8_t owner_script_hash[BLAKE2B_BLOCK_SIZE] = {0};
 
+  uint8_t *owner_script = arena_alloc(SCRIPT_SIZE);
+  CHECK2(owner_script != NULL, ERROR_NOT_ENOUGH_BUFF);
   err = get_owner_script(owner_script, SCRIPT_SIZE, &owner_script_len);
   CHECK(err);
 
@@ -330,29 +1035,12 @@ int check_enhanced_owner_mode(int *owner_mode) {
                 owner_script_len, NULL, 0);
   CHECK2(err == 0, ERROR_BLAKE2B_ERROR);
 
-  // get 32 bytes hash from args and compare it to owner script hash
-  {
-    uint64_t len = SCRIPT_SIZE;
-    int ret = ckb_checked_load_script(g_script, &len, 0);
-    CHECK(ret);
-    CHECK2(len <= SCRIPT_SIZE, ERROR_SCRIPT_TOO_LONG);
-
-    mol_seg_t script_seg;
-    script_seg.ptr = g_script;
-    script_seg.size = len;
-
-    mol_errno mol_err = MolReader_Script_verify(&script_seg, false);
-    CHECK2(mol_err == MOL_OK, ERROR_ENCODING);
-
-    mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
-    mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
-    CHECK2(args_bytes_seg.size >= BLAKE2B_BLOCK_SIZE, ERROR_ARGUMENTS_LEN);
-
-    if (memcmp(owner_script_hash, args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE) !=
-        0) {
-      CHECK2(false, ERROR_HASH_MISMATCHED);
-    }
-  }
+  // compare 32 bytes hash from args to owner script hash, the args are
+  // already loaded and verified by parse_args
+  CHECK2(g_args_bytes_seg.size >= BLAKE2B_BLOCK_SIZE, ERROR_ARGUMENTS_LEN);
+  int cmp =
+      memcmp(owner_script_hash, g_args_bytes_seg.ptr, BLAKE2B_BLOCK_SIZE);
+  CHECK2(cmp == 0, ERROR_HASH_MISMATCHED);
 
   // execute owner script
   mol_seg_t owner_script_seg = {.ptr = owner_script, .size = owner_script_len};
@@ -363,46 +1051,47 @@ int check_enhanced_owner_mode(int *owner_mode) {
 
   mol_seg_t owner_args_seg = MolReader_Script_get_args(&owner_script_seg);
   mol_seg_t owner_args_bytes_seg = MolReader_Bytes_raw_bytes(&owner_args_seg);
+  uint8_t hash_type2 = *(uint8_t *)hash_type.ptr;
+  uint8_t code_hash2[BLAKE2B_BLOCK_SIZE];
+  memcpy(code_hash2, code_hash.ptr, BLAKE2B_BLOCK_SIZE);
 
-  ValidateFuncType func = NULL;
+  // only the args are kept, the rest of arena can be used by the owner script
+  memmove(owner_script, owner_args_bytes_seg.ptr, owner_args_bytes_seg.size);
+  owner_args_bytes_seg.ptr = owner_script;
+  arena_release(mark + ARENA_ROUND_UP(owner_args_bytes_seg.size));
+
+  ValidateFunc func = {0};
   XUDTValidateFuncCategory cat = CateNormal;
-  err = load_validate_func(g_code_buff, &g_code_used, code_hash.ptr,
-                           *(uint8_t *)hash_type.ptr, &func, &cat);
+  err = load_validate_func(code_hash2, hash_type2, &func, &cat);
   CHECK(err);
 
-  err = func(0, 0, owner_args_bytes_seg.ptr, owner_args_bytes_seg.size);
+  err = call_validate_func(&func, 0, 0, owner_args_bytes_seg.ptr,
+                           owner_args_bytes_seg.size);
   CHECK(err);
   *owner_mode = 1;
 
 exit:
+  arena_release(mark);
+#if XUDT_ENABLE_RCE
+  // an RCE owner script creates its state above "mark", it's released too
+  rce_reset();
+#endif
   return err;
 }
+#endif  // XUDT_ENABLE_EXTENSIONS
 
-// *var_data will point to "Raw Extension Data", which can be in args or witness
-// *var_data will refer to a memory location of g_script or g_raw_extension_data
-int parse_args(int *owner_mode, XUDTFlags *flags, uint8_t **var_data,
-               uint32_t *var_len, uint8_t *hashes, uint32_t *hashes_count) {
+// Owner mode is resolved on demand, only when a later step depends on it: the
+// lock hashes, type hashes and the witness are not touched for a plain xUDT
+// transfer whose amounts already balance.
+int resolve_owner_mode(int *owner_mode) {
   int err = 0;
   bool owner_mode_for_input_type = false;
   bool owner_mode_for_output_type = false;
   // default is on
   bool owner_mode_for_input_lock = true;
+  mol_seg_t args_bytes_seg = g_args_bytes_seg;
 
-  uint64_t len = SCRIPT_SIZE;
-  int ret = ckb_checked_load_script(g_script, &len, 0);
-  CHECK(ret);
-  CHECK2(len <= SCRIPT_SIZE, ERROR_SCRIPT_TOO_LONG);
-
-  mol_seg_t script_seg;
-  script_seg.ptr = g_script;
-  script_seg.size = len;
-
-  mol_errno mol_err = MolReader_Script_verify(&script_seg, false);
-  CHECK2(mol_err == MOL_OK, ERROR_ENCODING);
-
-  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
-  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
-  CHECK2(args_bytes_seg.size >= BLAKE2B_BLOCK_SIZE, ERROR_ARGUMENTS_LEN);
+  arena_enter_phase(XudtPhaseOwnerMode);
 
   if (args_bytes_seg.size >= (FLAGS_SIZE + BLAKE2B_BLOCK_SIZE)) {
     uint32_t val = *(uint32_t *)(args_bytes_seg.ptr + BLAKE2B_BLOCK_SIZE);
@@ -417,27 +1106,6 @@ int parse_args(int *owner_mode, XUDTFlags *flags, uint8_t **var_data,
     }
   }
 
-  *hashes_count = 0;
-
-  // collect hashes
-  size_t i = 0;
-  while (1) {
-    uint8_t buffer[BLAKE2B_BLOCK_SIZE];
-    uint64_t len2 = BLAKE2B_BLOCK_SIZE;
-    ret = ckb_checked_load_cell_by_field(buffer, &len2, 0, i, CKB_SOURCE_INPUT,
-                                         CKB_CELL_FIELD_LOCK_HASH);
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      break;
-    }
-    CHECK(ret);
-    CHECK2(*hashes_count < MAX_LOCK_SCRIPT_HASH_COUNT, ERROR_TOO_MANY_LOCK);
-
-    memcpy(&hashes[(*hashes_count) * BLAKE2B_BLOCK_SIZE], buffer,
-           BLAKE2B_BLOCK_SIZE);
-    *hashes_count += 1;
-    i += 1;
-  }
-
   *owner_mode = 0;
 
   if (owner_mode_for_input_lock && *owner_mode == 0) {
@@ -456,11 +1124,44 @@ int parse_args(int *owner_mode, XUDTFlags *flags, uint8_t **var_data,
                            args_bytes_seg, owner_mode);
     CHECK(err);
   }
+#if XUDT_ENABLE_EXTENSIONS
+  // check enhanced mode here
+  if (*owner_mode == 0) {
+    check_enhanced_owner_mode(owner_mode);
+    // don't need to check the return result from this function
+    // if failed, owner mode is still false
+  }
+#endif
+
+exit:
+  return err;
+}
+
+// "list" will refer to "Raw Extension Data", which can be in args or witness.
+// When it's in args, it refers to a memory location of g_script.
+int parse_args(XUDTFlags *flags, ExtensionList *list) {
+  int err = 0;
+
+  uint64_t len = SCRIPT_SIZE;
+  int ret = ckb_checked_load_script(g_script, &len, 0);
+  CHECK(ret);
+  CHECK2(len <= SCRIPT_SIZE, ERROR_SCRIPT_TOO_LONG);
+
+  mol_seg_t script_seg;
+  script_seg.ptr = g_script;
+  script_seg.size = len;
+
+  mol_errno mol_err = MolReader_Script_verify(&script_seg, false);
+  CHECK2(mol_err == MOL_OK, ERROR_ENCODING);
+
+  mol_seg_t args_seg = MolReader_Script_get_args(&script_seg);
+  mol_seg_t args_bytes_seg = MolReader_Bytes_raw_bytes(&args_seg);
+  CHECK2(args_bytes_seg.size >= BLAKE2B_BLOCK_SIZE, ERROR_ARGUMENTS_LEN);
+  g_args_bytes_seg = args_bytes_seg;
 
   // parse xUDT args
+  memset(list, 0, sizeof(ExtensionList));
   if (args_bytes_seg.size < (FLAGS_SIZE + BLAKE2B_BLOCK_SIZE)) {
-    *var_data = NULL;
-    *var_len = 0;
     *flags = XUDTFlagsPlain;
   } else {
     uint32_t temp_flags =
@@ -468,33 +1169,32 @@ int parse_args(int *owner_mode, XUDTFlags *flags, uint8_t **var_data,
         ~OWNER_MODE_MASK;
     if (temp_flags == XUDTFlagsPlain) {
       *flags = XUDTFlagsPlain;
+#if XUDT_ENABLE_EXTENSIONS
     } else if (temp_flags == XUDTFlagsInArgs) {
       uint32_t real_size = 0;
       *flags = XUDTFlagsInArgs;
-      *var_len = args_bytes_seg.size - BLAKE2B_BLOCK_SIZE - FLAGS_SIZE;
-      *var_data = args_bytes_seg.ptr + BLAKE2B_BLOCK_SIZE + FLAGS_SIZE;
+      list->seg.size = args_bytes_seg.size - BLAKE2B_BLOCK_SIZE - FLAGS_SIZE;
+      list->seg.ptr = args_bytes_seg.ptr + BLAKE2B_BLOCK_SIZE + FLAGS_SIZE;
 
-      err = verify_script_vec(*var_data, *var_len, &real_size);
+      err = verify_script_vec(list->seg.ptr, list->seg.size, &real_size);
       CHECK(err);
       // note, it's different than "flag = 2"
-      CHECK2(real_size == *var_len, ERROR_INVALID_ARGS_FORMAT);
+      CHECK2(real_size == list->seg.size, ERROR_INVALID_ARGS_FORMAT);
+      CHECK2(MolReader_ScriptVec_verify(&list->seg, true) == MOL_OK,
+             ERROR_INVALID_ARGS_FORMAT);
+      list->size = list->seg.size;
+      list->count = MolReader_ScriptVec_length(&list->seg);
     } else if (temp_flags == XUDTFlagsInWitness) {
       *flags = XUDTFlagsInWitness;
       uint32_t hash_size =
           args_bytes_seg.size - BLAKE2B_BLOCK_SIZE - FLAGS_SIZE;
       CHECK2(hash_size == BLAKE160_SIZE, ERROR_INVALID_FLAG);
 
-      err = load_raw_extension_data(var_data, var_len);
-      CHECK(err);
-      CHECK2(var_len > 0, ERROR_INVALID_MOL_FORMAT);
-      // verify the hash
-      uint8_t hash[BLAKE2B_BLOCK_SIZE] = {0};
       uint8_t *blake160_hash =
           args_bytes_seg.ptr + BLAKE2B_BLOCK_SIZE + FLAGS_SIZE;
-      err = blake2b(hash, BLAKE2B_BLOCK_SIZE, *var_data, *var_len, NULL, 0);
-      CHECK2(err == 0, ERROR_BLAKE2B_ERROR);
-      CHECK2(memcmp(blake160_hash, hash, BLAKE160_SIZE) == 0,
-             ERROR_HASH_MISMATCHED);
+      err = load_raw_extension_data(blake160_hash, list);
+      CHECK(err);
+#endif
     } else {
       CHECK2(false, ERROR_INVALID_FLAG);
     }
@@ -506,125 +1206,60 @@ exit:
 
 // copied from simple_udt.c
 int simple_udt(int owner_mode) {
+  int err = 0;
+#if XUDT_PAIRED_AMOUNTS
+  // The amounts are paired by index even in owner mode: the output at index i
+  // must carry the same amount as the input at index i.
+  err = tx_ctx_load_group_amounts();
+  if (err != 0) {
+    return err;
+  }
+  if (g_tx_ctx.group_input_amount != 0 && g_tx_ctx.group_output_amount != 0 &&
+      g_tx_ctx.amounts_mismatched) {
+    return ERROR_AMOUNT;
+  }
+#endif
   if (owner_mode)
     return CKB_SUCCESS;
 
-  int ret = 0;
   // When the owner mode is not enabled, however, we will then need to ensure
   // the sum of all input tokens is not smaller than the sum of all output
-  // tokens. First, let's loop through all input cells containing current UDTs,
-  // and gather the sum of all input tokens.
-  uint128_t input_amount = 0;
-  size_t i = 0;
-  uint64_t len = 0;
-  while (1) {
-    uint128_t current_amount = 0;
-    len = 16;
-    // The implementation here does not require that the transaction only
-    // contains UDT cells for the current UDT type. It's perfectly fine to mix
-    // the cells for multiple different types of UDT together in one
-    // transaction. But that also means we need a way to tell one UDT type from
-    // another UDT type. The trick is in the `CKB_SOURCE_GROUP_INPUT` value used
-    // here. When using it as the source part of the syscall, the syscall would
-    // only iterate through cells with the same script as the current running
-    // script. Since different UDT types will naturally have different
-    // script(the args part will be different), we can be sure here that this
-    // loop would only iterate through UDTs that are of the same type as the one
-    // identified by the current running script.
-    //
-    // In the case that multiple UDT types are included in the same transaction,
-    // this simple UDT script will be run multiple times to validate the
-    // transaction, each time with a different script containing different
-    // script args, representing different UDT types.
-    //
-    // A different trick used here, is that our current implementation assumes
-    // that the amount of UDT is stored as unsigned 128-bit little endian
-    // integer in the first 16 bytes of cell data. Since RISC-V also uses little
-    // endian format, we can just read the first 16 bytes of cell data into
-    // `current_amount`, which is just an unsigned 128-bit integer in C. The
-    // memory layout of a C program will ensure that the value is set correctly.
-    ret = ckb_load_cell_data((uint8_t *)&current_amount, &len, 0, i,
-                             CKB_SOURCE_GROUP_INPUT);
-    // When `CKB_INDEX_OUT_OF_BOUND` is reached, we know we have iterated
-    // through all cells of current type.
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      break;
-    }
-    if (ret != CKB_SUCCESS) {
-      return ret;
-    }
-    if (len < 16) {
-      return ERROR_ENCODING;
-    }
-    input_amount += current_amount;
-    // Like any serious smart contract out there, we will need to check for
-    // overflows.
-    if (input_amount < current_amount) {
-      return ERROR_OVERFLOWING;
-    }
-    i += 1;
-  }
-
-  // With the sum of all input UDT tokens gathered, let's now iterate through
-  // output cells to grab the sum of all output UDT tokens.
-  uint128_t output_amount = 0;
-  i = 0;
-  while (1) {
-    uint128_t current_amount = 0;
-    len = 16;
-    // Similar to the above code piece, we are also looping through output cells
-    // with the same script as current running script here by using
-    // `CKB_SOURCE_GROUP_OUTPUT`.
-    ret = ckb_load_cell_data((uint8_t *)&current_amount, &len, 0, i,
-                             CKB_SOURCE_GROUP_OUTPUT);
-    if (ret == CKB_INDEX_OUT_OF_BOUND) {
-      break;
-    }
-    if (ret != CKB_SUCCESS) {
-      return ret;
-    }
-    if (len < 16) {
-      return ERROR_ENCODING;
-    }
-    output_amount += current_amount;
-    // Like any serious smart contract out there, we will need to check for
-    // overflows.
-    if (output_amount < current_amount) {
-      return ERROR_OVERFLOWING;
-    }
-    i += 1;
+  // tokens.
+  err = tx_ctx_load_group_amounts();
+  if (err != 0) {
+    return err;
   }
 
   // When both value are gathered, we can perform the final check here to
   // prevent non-authorized token issuance.
-  if (input_amount < output_amount) {
+  if (g_tx_ctx.group_input_amount < g_tx_ctx.group_output_amount) {
     return ERROR_AMOUNT;
   }
   return CKB_SUCCESS;
 }
 
+#if XUDT_ENABLE_EXTENSIONS
 // If the extension script is identical to a lock script of one input cell in
 // current transaction, we consider the extension script to be already
 // validated, no additional check is needed for current extension
-int is_extension_script_validated(mol_seg_t extension_script,
-                                  uint8_t *input_lock_script_hash,
-                                  uint32_t input_lock_script_hash_count) {
+int is_extension_script_validated(mol_seg_t extension_script) {
   int err = 0;
   uint8_t hash[BLAKE2B_BLOCK_SIZE];
   err = blake2b(hash, BLAKE2B_BLOCK_SIZE, extension_script.ptr,
                 extension_script.size, NULL, 0);
   CHECK2(err == 0, ERROR_BLAKE2B_ERROR);
 
-  for (uint32_t i = 0; i < input_lock_script_hash_count; i++) {
-    if (memcmp(&input_lock_script_hash[i * BLAKE2B_BLOCK_SIZE], hash,
-               BLAKE2B_BLOCK_SIZE) == 0) {
-      return 0;
-    }
+  bool found = false;
+  err = tx_ctx_has_input_lock_hash(hash, &found);
+  CHECK(err);
+  if (found) {
+    return 0;
   }
   err = ERROR_NOT_VALIDATED;
 exit:
   return err;
 }
+#endif
 
 #ifdef CKB_USE_SIM
 int simulator_main() {
@@ -633,72 +1268,96 @@ int main() {
 #endif
   int err = 0;
   int owner_mode = 0;
-  uint8_t *raw_extension_data = NULL;
-  uint32_t raw_extension_len = 0;
+  ExtensionList extension_list = {0};
   XUDTFlags flags = XUDTFlagsPlain;
-  uint8_t
-      input_lock_script_hashes[MAX_LOCK_SCRIPT_HASH_COUNT * BLAKE2B_BLOCK_SIZE];
-  uint32_t input_lock_script_hash_count = 0;
-  err = parse_args(&owner_mode, &flags, &raw_extension_data, &raw_extension_len,
-                   input_lock_script_hashes, &input_lock_script_hash_count);
+
+  tx_ctx_reset();
+#if XUDT_ENABLE_DLOPEN
+  g_loaded_libs_count = 0;
+  g_code_used = 0;
+#endif
+  arena_reset();
+#if XUDT_ENABLE_RCE
+  rce_reset();
+#endif
+  err = parse_args(&flags, &extension_list);
   CHECK(err);
-  CHECK2(owner_mode == 1 || owner_mode == 0, ERROR_INVALID_ARGS_FORMAT);
-  // check enhanced mode here
-  if (!owner_mode) {
-    check_enhanced_owner_mode(&owner_mode);
-    // don't need to check the return result from this function
-    // if failed, owner mode is still false
+
+  if (flags == XUDTFlagsPlain) {
+    // owner mode can only make a difference when the amount check fails
+    err = simple_udt(0);
+    if (err != 0) {
+      int err2 = resolve_owner_mode(&owner_mode);
+      CHECK(err2);
+      if (owner_mode) {
+        // the pairing of amounts is still checked
+        err = simple_udt(owner_mode);
+      }
+    }
+    goto exit;
   }
 
-  if (flags != XUDTFlagsPlain) {
-    CHECK2(raw_extension_data != NULL, ERROR_INVALID_ARGS_FORMAT);
-    CHECK2(raw_extension_len > 0, ERROR_INVALID_ARGS_FORMAT);
+#if XUDT_ENABLE_EXTENSIONS
+  // Cheap checks come first: a transaction which will fail should be rejected
+  // before the lock hashes are collected and any library is loaded.
+  CHECK2(extension_list.size > 0, ERROR_INVALID_ARGS_FORMAT);
+  uint32_t rce_end = 0;
+  err = check_extension_list(&extension_list, &rce_end);
+  CHECK(err);
+#if XUDT_ENABLE_DLOPEN
+  g_validate_ctx.raw_extension_data =
+      extension_list.in_witness ? NULL : extension_list.seg.ptr;
+  g_validate_ctx.raw_extension_data_len = extension_list.size;
+#endif
+
+  err = resolve_owner_mode(&owner_mode);
+  CHECK(err);
+  CHECK2(owner_mode == 1 || owner_mode == 0, ERROR_INVALID_ARGS_FORMAT);
+  if (!owner_mode && rce_end > 0) {
+    // The proofs of every RCE extension must be in witness. Their count is
+    // checked against the RCRules while RCData cells are loaded: the rules
+    // are only known after the RC graph is walked.
+    SmtProofEntryVecType proofs;
+    err = rce_get_proofs(rce_end - 1, &proofs);
+    CHECK(err);
   }
   err = simple_udt(owner_mode);
   if (err != 0) {
     goto exit;
   }
 
-  if (flags == XUDTFlagsPlain) {
-    err = 0;
-    goto exit;
-  }
-
-  mol_seg_t raw_extension_seg = {0};
-  raw_extension_seg.ptr = raw_extension_data;
-  raw_extension_seg.size = raw_extension_len;
-  CHECK2(MolReader_ScriptVec_verify(&raw_extension_seg, true) == MOL_OK,
-         ERROR_INVALID_ARGS_FORMAT);
-  uint32_t size = MolReader_ScriptVec_length(&raw_extension_seg);
-  for (uint32_t i = 0; i < size; i++) {
-    ValidateFuncType func;
-    mol_seg_res_t res = MolReader_ScriptVec_get(&raw_extension_seg, i);
-    CHECK2(res.errno == 0, ERROR_INVALID_MOL_FORMAT);
-    CHECK2(MolReader_Script_verify(&res.seg, false) == MOL_OK,
-           ERROR_INVALID_MOL_FORMAT);
+  arena_enter_phase(XudtPhaseExtensions);
+  for (uint32_t i = 0; i < extension_list.count; i++) {
+    ValidateFunc func = {0};
+    mol_seg_t script = {0};
+    err = extension_list_get(&extension_list, i, &script);
+    CHECK(err);
 
-    mol_seg_t code_hash = MolReader_Script_get_code_hash(&res.seg);
-    mol_seg_t hash_type = MolReader_Script_get_hash_type(&res.seg);
-    mol_seg_t args = MolReader_Script_get_args(&res.seg);
+    mol_seg_t code_hash = MolReader_Script_get_code_hash(&script);
+    mol_seg_t hash_type = MolReader_Script_get_hash_type(&script);
+    mol_seg_t args = MolReader_Script_get_args(&script);
 
     uint8_t hash_type2 = *((uint8_t *)hash_type.ptr);
-    XUDTValidateFuncCategory cat = CateNormal;
-    err = load_validate_func(g_code_buff, &g_code_used, code_hash.ptr,
-                             hash_type2, &func, &cat);
-    CHECK(err);
-    // RCE is with high priority, must be checked
-    if (cat != CateRce) {
-      int err2 = is_extension_script_validated(
-          res.seg, input_lock_script_hashes, input_lock_script_hash_count);
+    // RCE is with high priority, must be checked. Others are skipped before
+    // their code is loaded if they're already validated.
+    const BuiltinExtension *builtin =
+        find_builtin_extension(code_hash.ptr, hash_type2);
+    if (builtin == NULL || builtin->cat != CateRce) {
+      int err2 = is_extension_script_validated(script);
       if (err2 == 0) {
         continue;
       }
     }
+    XUDTValidateFuncCategory cat = CateNormal;
+    err = load_validate_func(code_hash.ptr, hash_type2, &func, &cat);
+    CHECK(err);
     mol_seg_t args_raw_bytes = MolReader_Bytes_raw_bytes(&args);
 
-    err = func(owner_mode, i, args_raw_bytes.ptr, args_raw_bytes.size);
+    err = call_validate_func(&func, owner_mode, i, args_raw_bytes.ptr,
+                             args_raw_bytes.size);
     CHECK(err);
   }
+#endif  // XUDT_ENABLE_EXTENSIONS
 
   err = 0;
 exit:
@@ -42,6 +42,11 @@ MOLECULE_API_DECORATOR  mol_errno       MolReader_XudtWitnessInput_verify
 #define                                 MolReader_RCCellVec_verify(s, c)                mol_fixvec_verify(s, 32)
 #define                                 MolReader_RCCellVec_length(s)                   mol_fixvec_length(s)
 #define                                 MolReader_RCCellVec_get(s, i)                   mol_fixvec_slice_by_index(s, 32, i)
+MOLECULE_API_DECORATOR  mol_errno       MolReader_RCSortedList_verify                   (const mol_seg_t*, bool);
+#define                                 MolReader_RCSortedList_actual_field_count(s)    mol_table_actual_field_count(s)
+#define                                 MolReader_RCSortedList_has_extra_fields(s)      mol_table_has_extra_fields(s, 2)
+#define                                 MolReader_RCSortedList_get_flags(s)             mol_table_slice_by_index(s, 0)
+#define                                 MolReader_RCSortedList_get_hashes(s)            mol_table_slice_by_index(s, 1)
 MOLECULE_API_DECORATOR  mol_errno       MolReader_RCData_verify                         (const mol_seg_t*, bool);
 #define                                 MolReader_RCData_unpack(s)                      mol_union_unpack(s)
 #define                                 MolReader_SmtProof_verify(s, c)                 mol_fixvec_verify(s, 1)
@@ -101,9 +106,15 @@ MOLECULE_API_DECORATOR  mol_seg_res_t   MolBuilder_XudtWitnessInput_build
 #define                                 MolBuilder_RCCellVec_push(b, p)                 mol_fixvec_builder_push(b, p, 32)
 #define                                 MolBuilder_RCCellVec_build(b)                   mol_fixvec_builder_finalize(b)
 #define                                 MolBuilder_RCCellVec_clear(b)                   mol_builder_discard(b)
+#define                                 MolBuilder_RCSortedList_init(b)                 mol_table_builder_initialize(b, 128, 2)
+#define                                 MolBuilder_RCSortedList_set_flags(b, p)         mol_table_builder_add_byte(b, 0, p)
+#define                                 MolBuilder_RCSortedList_set_hashes(b, p, l)     mol_table_builder_add(b, 1, p, l)
+MOLECULE_API_DECORATOR  mol_seg_res_t   MolBuilder_RCSortedList_build                   (mol_builder_t);
+#define                                 MolBuilder_RCSortedList_clear(b)                mol_builder_discard(b)
 #define                                 MolBuilder_RCData_init(b)                       mol_union_builder_initialize(b, 64, 0, &MolDefault_RCRule, 33)
 #define                                 MolBuilder_RCData_set_RCRule(b, p, l)           mol_union_builder_set(b, 0, p, l)
 #define                                 MolBuilder_RCData_set_RCCellVec(b, p, l)        mol_union_builder_set(b, 1, p, l)
+#define                                 MolBuilder_RCData_set_RCSortedList(b, p, l)     mol_union_builder_set(b, 2, p, l)
 #define                                 MolBuilder_RCData_build(b)                      mol_builder_finalize_simple(b)
 #define                                 MolBuilder_RCData_clear(b)                      mol_builder_discard(b)
 #define                                 MolBuilder_SmtProof_init(b)                     mol_fixvec_builder_initialize(b, 16)
@@ -157,6 +168,10 @@ MOLECULE_API_DECORATOR const uint8_t MolDefault_RCRule[33]       =  {
     ____, ____, ____, ____, ____, ____, ____, ____, ____,
 };
 MOLECULE_API_DECORATOR const uint8_t MolDefault_RCCellVec[4]     =  {____, ____, ____, ____};
+MOLECULE_API_DECORATOR const uint8_t MolDefault_RCSortedList[17] =  {
+    0x11, ____, ____, ____, 0x0c, ____, ____, ____, 0x0d, ____, ____, ____,
+    ____, ____, ____, ____, ____,
+};
 MOLECULE_API_DECORATOR const uint8_t MolDefault_RCData[37]       =  {
     ____, ____, ____, ____, ____, ____, ____, ____, ____, ____, ____, ____,
     ____, ____, ____, ____, ____, ____, ____, ____, ____, ____, ____, ____,
@@ -312,6 +327,58 @@ MOLECULE_API_DECORATOR mol_errno MolReader_XudtWitnessInput_verify (const mol_se
         }
     return MOL_OK;
 }
+MOLECULE_API_DECORATOR mol_errno MolReader_RCSortedList_verify (const mol_seg_t *input, bool compatible) {
+    if (input->size < MOL_NUM_T_SIZE) {
+        return MOL_ERR_HEADER;
+    }
+    uint8_t *ptr = input->ptr;
+    mol_num_t total_size = mol_unpack_number(ptr);
+    if (input->size != total_size) {
+        return MOL_ERR_TOTAL_SIZE;
+    }
+    if (input->size < MOL_NUM_T_SIZE * 2) {
+        return MOL_ERR_HEADER;
+    }
+    ptr += MOL_NUM_T_SIZE;
+    mol_num_t offset = mol_unpack_number(ptr);
+    if (offset % 4 > 0 || offset < MOL_NUM_T_SIZE*2) {
+        return MOL_ERR_OFFSET;
+    }
+    mol_num_t field_count = offset / 4 - 1;
+    if (field_count < 2) {
+        return MOL_ERR_FIELD_COUNT;
+    } else if (!compatible && field_count > 2) {
+        return MOL_ERR_FIELD_COUNT;
+    }
+    if (input->size < MOL_NUM_T_SIZE*(field_count+1)){
+        return MOL_ERR_HEADER;
+    }
+    mol_num_t offsets[field_count+1];
+    offsets[0] = offset;
+    for (mol_num_t i=1; i<field_count; i++) {
+        ptr += MOL_NUM_T_SIZE;
+        offsets[i] = mol_unpack_number(ptr);
+        if (offsets[i-1] > offsets[i]) {
+            return MOL_ERR_OFFSET;
+        }
+    }
+    if (offsets[field_count-1] > total_size) {
+        return MOL_ERR_OFFSET;
+    }
+    offsets[field_count] = total_size;
+        mol_seg_t inner;
+        mol_errno errno;
+        if (offsets[1] - offsets[0] != 1) {
+            return MOL_ERR_DATA;
+        }
+        inner.ptr = input->ptr + offsets[1];
+        inner.size = offsets[2] - offsets[1];
+        errno = MolReader_Byte32Vec_verify(&inner, compatible);
+        if (errno != MOL_OK) {
+            return MOL_ERR_DATA;
+        }
+    return MOL_OK;
+}
 MOLECULE_API_DECORATOR mol_errno MolReader_RCData_verify (const mol_seg_t *input, bool compatible) {
     if (input->size < MOL_NUM_T_SIZE) {
         return MOL_ERR_HEADER;
@@ -325,6 +392,8 @@ MOLECULE_API_DECORATOR mol_errno MolReader_RCData_verify (const mol_seg_t *input
             return MolReader_RCRule_verify(&inner, compatible);
         case 1:
             return MolReader_RCCellVec_verify(&inner, compatible);
+        case 2:
+            return MolReader_RCSortedList_verify(&inner, compatible);
         default:
             return MOL_ERR_UNKNOWN_ITEM;
     }
@@ -618,6 +687,50 @@ MOLECULE_API_DECORATOR mol_seg_res_t MolBuilder_XudtWitnessInput_build (mol_buil
     mol_builder_discard(builder);
     return res;
 }
+MOLECULE_API_DECORATOR mol_seg_res_t MolBuilder_RCSortedList_build (mol_builder_t builder) {
+    mol_seg_res_t res;
+    res.errno = MOL_OK;
+    mol_num_t offset = 12;
+    mol_num_t len;
+    res.seg.size = offset;
+    len = builder.number_ptr[1];
+    res.seg.size += len == 0 ? 1 : len;
+    len = builder.number_ptr[3];
+    res.seg.size += len == 0 ? 4 : len;
+    res.seg.ptr = (uint8_t*)malloc(res.seg.size);
+    uint8_t *dst = res.seg.ptr;
+    mol_pack_number(dst, &res.seg.size);
+    dst += MOL_NUM_T_SIZE;
+    mol_pack_number(dst, &offset);
+    dst += MOL_NUM_T_SIZE;
+    len = builder.number_ptr[1];
+    offset += len == 0 ? 1 : len;
+    mol_pack_number(dst, &offset);
+    dst += MOL_NUM_T_SIZE;
+    len = builder.number_ptr[3];
+    offset += len == 0 ? 4 : len;
+    uint8_t *src = builder.data_ptr;
+    len = builder.number_ptr[1];
+    if (len == 0) {
+        len = 1;
+        *dst = 0;
+    } else {
+        mol_num_t of = builder.number_ptr[0];
+        memcpy(dst, src+of, len);
+    }
+    dst += len;
+    len = builder.number_ptr[3];
+    if (len == 0) {
+        len = 4;
+        memcpy(dst, &MolDefault_Byte32Vec, len);
+    } else {
+        mol_num_t of = builder.number_ptr[2];
+        memcpy(dst, src+of, len);
+    }
+    dst += len;
+    mol_builder_discard(builder);
+    return res;
+}
 MOLECULE_API_DECORATOR mol_seg_res_t MolBuilder_SmtProofEntry_build (mol_builder_t builder) {
     mol_seg_res_t res;
     res.errno = MOL_OK;
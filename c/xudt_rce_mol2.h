@@ -48,6 +48,12 @@ struct RCCellVecVTable *GetRCCellVecVTable(void);
 struct RCCellVecType make_RCCellVec(mol2_cursor_t *cur);
 uint32_t RCCellVec_len_impl(struct RCCellVecType *);
 mol2_cursor_t RCCellVec_get_impl(struct RCCellVecType *, uint32_t, bool *);
+struct RCSortedListType;
+struct RCSortedListVTable;
+struct RCSortedListVTable *GetRCSortedListVTable(void);
+struct RCSortedListType make_RCSortedList(mol2_cursor_t *cur);
+uint8_t RCSortedList_get_flags_impl(struct RCSortedListType *);
+struct Byte32VecType RCSortedList_get_hashes_impl(struct RCSortedListType *);
 struct RCDataType;
 struct RCDataVTable;
 struct RCDataVTable *GetRCDataVTable(void);
@@ -55,6 +61,7 @@ struct RCDataType make_RCData(mol2_cursor_t *cur);
 uint32_t RCData_item_id_impl(struct RCDataType *);
 struct RCRuleType RCData_as_RCRule_impl(struct RCDataType *);
 struct RCCellVecType RCData_as_RCCellVec_impl(struct RCDataType *);
+struct RCSortedListType RCData_as_RCSortedList_impl(struct RCDataType *);
 struct SmtProofType;
 struct SmtProofVTable;
 struct SmtProofVTable *GetSmtProofVTable(void);
@@ -150,10 +157,20 @@ typedef struct RCCellVecType {
   RCCellVecVTable *t;
 } RCCellVecType;
 
+typedef struct RCSortedListVTable {
+  uint8_t (*flags)(struct RCSortedListType *);
+  struct Byte32VecType (*hashes)(struct RCSortedListType *);
+} RCSortedListVTable;
+typedef struct RCSortedListType {
+  mol2_cursor_t cur;
+  RCSortedListVTable *t;
+} RCSortedListType;
+
 typedef struct RCDataVTable {
   uint32_t (*item_id)(struct RCDataType *);
   struct RCRuleType (*as_RCRule)(struct RCDataType *);
   struct RCCellVecType (*as_RCCellVec)(struct RCDataType *);
+  struct RCSortedListType (*as_RCSortedList)(struct RCDataType *);
 } RCDataVTable;
 typedef struct RCDataType {
   mol2_cursor_t cur;
@@ -391,6 +408,33 @@ mol2_cursor_t RCCellVec_get_impl(RCCellVecType *this, uint32_t index,
   ret = convert_to_array(&res.cur);
   return ret;
 }
+struct RCSortedListType make_RCSortedList(mol2_cursor_t *cur) {
+  RCSortedListType ret;
+  ret.cur = *cur;
+  ret.t = GetRCSortedListVTable();
+  return ret;
+}
+struct RCSortedListVTable *GetRCSortedListVTable(void) {
+  static RCSortedListVTable s_vtable;
+  static int inited = 0;
+  if (inited) return &s_vtable;
+  s_vtable.flags = RCSortedList_get_flags_impl;
+  s_vtable.hashes = RCSortedList_get_hashes_impl;
+  return &s_vtable;
+}
+uint8_t RCSortedList_get_flags_impl(RCSortedListType *this) {
+  uint8_t ret;
+  mol2_cursor_t ret2 = mol2_table_slice_by_index(&this->cur, 0);
+  ret = convert_to_Uint8(&ret2);
+  return ret;
+}
+Byte32VecType RCSortedList_get_hashes_impl(RCSortedListType *this) {
+  Byte32VecType ret;
+  mol2_cursor_t cur = mol2_table_slice_by_index(&this->cur, 1);
+  ret.cur = cur;
+  ret.t = GetByte32VecVTable();
+  return ret;
+}
 struct RCDataType make_RCData(mol2_cursor_t *cur) {
   RCDataType ret;
   ret.cur = *cur;
@@ -404,6 +448,7 @@ struct RCDataVTable *GetRCDataVTable(void) {
   s_vtable.item_id = RCData_item_id_impl;
   s_vtable.as_RCRule = RCData_as_RCRule_impl;
   s_vtable.as_RCCellVec = RCData_as_RCCellVec_impl;
+  s_vtable.as_RCSortedList = RCData_as_RCSortedList_impl;
   return &s_vtable;
 }
 uint32_t RCData_item_id_impl(RCDataType *this) {
@@ -423,6 +468,13 @@ RCCellVecType RCData_as_RCCellVec_impl(RCDataType *this) {
   ret.t = GetRCCellVecVTable();
   return ret;
 }
+RCSortedListType RCData_as_RCSortedList_impl(RCDataType *this) {
+  RCSortedListType ret;
+  mol2_union_t u = mol2_union_unpack(&this->cur);
+  ret.cur = u.cursor;
+  ret.t = GetRCSortedListVTable();
+  return ret;
+}
 struct SmtProofType make_SmtProof(mol2_cursor_t *cur) {
   SmtProofType ret;
   ret.cur = *cur;
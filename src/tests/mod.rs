@@ -1,5 +1,6 @@
 mod anyone_can_pay;
 mod secp256k1_compatibility;
+mod simple_udt;
 
 use ckb_crypto::secp::Privkey;
 use ckb_script::DataLoader;
@@ -39,6 +40,8 @@ lazy_static! {
         Bytes::from(&include_bytes!("../../build/secp256k1_data")[..]);
     pub static ref ALWAYS_SUCCESS: Bytes =
         Bytes::from(&include_bytes!("../../build/always_success")[..]);
+    pub static ref SIMPLE_UDT: Bytes =
+        Bytes::from(&include_bytes!("../../build/simple_udt")[..]);
 }
 
 #[derive(Default)]
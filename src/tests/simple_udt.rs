@@ -0,0 +1,92 @@
+use super::{build_resolved_tx, DummyDataLoader, ALWAYS_SUCCESS, MAX_CYCLES, SIMPLE_UDT};
+use ckb_script::TransactionScriptsVerifier;
+use ckb_types::{
+    bytes::Bytes,
+    core::{Capacity, DepType, ScriptHashType, TransactionBuilder, TransactionView},
+    packed::{CellDep, CellInput, CellOutput, OutPoint, Script},
+    prelude::*,
+};
+use rand::{thread_rng, Rng};
+
+fn random_out_point<R: Rng>(rng: &mut R) -> OutPoint {
+    let tx_hash = {
+        let mut buf = [0u8; 32];
+        rng.fill(&mut buf);
+        buf.pack()
+    };
+    OutPoint::new(tx_hash, 0)
+}
+
+fn add_code_cell<R: Rng>(dummy: &mut DummyDataLoader, code: &Bytes, rng: &mut R) -> CellDep {
+    let out_point = random_out_point(rng);
+    let cell = CellOutput::new_builder()
+        .capacity(Capacity::bytes(code.len()).expect("script capacity").pack())
+        .build();
+    dummy.cells.insert(out_point.clone(), (cell, code.clone()));
+    CellDep::new_builder()
+        .out_point(out_point)
+        .dep_type(DepType::Code.into())
+        .build()
+}
+
+// "count" UDT cells are transferred to "count" cells, not in owner mode
+fn gen_udt_transfer_tx(dummy: &mut DummyDataLoader, count: usize) -> TransactionView {
+    let mut rng = thread_rng();
+    let always_success_dep = add_code_cell(dummy, &ALWAYS_SUCCESS, &mut rng);
+    let simple_udt_dep = add_code_cell(dummy, &SIMPLE_UDT, &mut rng);
+
+    let lock = Script::new_builder()
+        .code_hash(CellOutput::calc_data_hash(&ALWAYS_SUCCESS))
+        .hash_type(ScriptHashType::Data.into())
+        .build();
+    let udt = Script::new_builder()
+        .code_hash(CellOutput::calc_data_hash(&SIMPLE_UDT))
+        .hash_type(ScriptHashType::Data.into())
+        .args(Bytes::from(vec![42u8; 32]).pack())
+        .build();
+    let cell = CellOutput::new_builder()
+        .capacity(Capacity::shannons(42).pack())
+        .lock(lock)
+        .type_(Some(udt).pack())
+        .build();
+    let amount = Bytes::from(100u128.to_le_bytes().to_vec());
+
+    let mut tx_builder = TransactionBuilder::default()
+        .cell_dep(always_success_dep)
+        .cell_dep(simple_udt_dep);
+    for _ in 0..count {
+        let previous_out_point = random_out_point(&mut rng);
+        dummy
+            .cells
+            .insert(previous_out_point.clone(), (cell.clone(), amount.clone()));
+        tx_builder = tx_builder
+            .input(CellInput::new(previous_out_point, 0))
+            .output(cell.clone())
+            .output_data(amount.pack());
+    }
+    tx_builder.build()
+}
+
+#[test]
+fn test_simple_udt_transfer_cycles() {
+    let counts = [1u64, 10, 100];
+    let mut cycles_per_cell = Vec::new();
+    for count in &counts {
+        let mut data_loader = DummyDataLoader::new();
+        let tx = gen_udt_transfer_tx(&mut data_loader, *count as usize);
+        let resolved_tx = build_resolved_tx(&data_loader, &tx);
+        let cycles = TransactionScriptsVerifier::new(&resolved_tx, &data_loader)
+            .verify(MAX_CYCLES)
+            .expect("pass verification");
+        cycles_per_cell.push(cycles / count);
+    }
+    // the script runs once for the whole group, its fixed cost is shared by
+    // the cells, only the amount of each cell is loaded again
+    for i in 1..counts.len() {
+        assert!(
+            cycles_per_cell[i] < cycles_per_cell[i - 1],
+            "cycles per cell: {:?}",
+            cycles_per_cell
+        );
+    }
+}
@@ -54,9 +54,17 @@ typedef struct SIMRCCellVec {
   RCHashType hash[MAX_RCRULE_IN_CELL];
 } SIMRCCellVec;
 
+typedef struct SIMRCSortedList {
+  uint8_t id;  // id = 2
+  uint8_t flags;
+  uint8_t hash_count;
+  const uint8_t (*hashes)[32];
+} SIMRCSortedList;
+
 typedef union SIMRCData {
   SIMRCRule rcrule;
   SIMRCCellVec rccell_vec;
+  SIMRCSortedList sorted_list;
 } SIMRCData;
 
 mol_seg_t build_rcdata(SIMRCData *rcdata) {
@@ -88,6 +96,25 @@ mol_seg_t build_rcdata(SIMRCData *rcdata) {
 
     MolBuilder_RCData_set_RCCellVec(&b2, res.seg.ptr, res.seg.size);
     free(res.seg.ptr);
+  } else if (rcdata->rcrule.id == 2) {
+    // RCSortedList, the hashes are not sorted here
+    mol_builder_t b;
+    MolBuilder_Byte32Vec_init(&b);
+    for (uint8_t i = 0; i < rcdata->sorted_list.hash_count; i++) {
+      MolBuilder_Byte32Vec_push(&b, rcdata->sorted_list.hashes[i]);
+    }
+    mol_seg_res_t hashes = MolBuilder_Byte32Vec_build(b);
+    ASSERT(hashes.errno == 0);
+
+    MolBuilder_RCSortedList_init(&b);
+    MolBuilder_RCSortedList_set_flags(&b, rcdata->sorted_list.flags);
+    MolBuilder_RCSortedList_set_hashes(&b, hashes.seg.ptr, hashes.seg.size);
+    mol_seg_res_t res = MolBuilder_RCSortedList_build(b);
+    ASSERT(res.errno == 0);
+
+    MolBuilder_RCData_set_RCSortedList(&b2, res.seg.ptr, res.seg.size);
+    free(hashes.seg.ptr);
+    free(res.seg.ptr);
   } else {
     ASSERT(false);
   }
@@ -17,6 +17,12 @@ mol_seg_t build_bytes(const uint8_t* data, uint32_t len);
 mol_seg_t build_script(const uint8_t* code_hash, uint8_t hash_type,
                        const uint8_t* args, uint32_t args_len);
 extern int g_lib_size;
+extern int g_dlopen_count;
+// count of the main syscalls (witness, script, cell data and cell fields,
+// dlopen), it's used as the cost of a run since there are no cycles here
+int g_syscall_count = 0;
+// bytes of witness copied to the script, CKB charges the syscalls by them too
+uint64_t g_witness_read_bytes = 0;
 // simulator for RCData
 typedef uint16_t RCHashType;
 
@@ -32,12 +38,24 @@ typedef struct SIMRCCellVec {
   RCHashType hash[MAX_RCRULE_IN_CELL];
 } SIMRCCellVec;
 
+// the hashes are in g_sim_sorted_list_hashes[first, first + hash_count)
+typedef struct SIMRCSortedList {
+  uint8_t id;  // id = 2
+  uint8_t flags;
+  uint16_t hash_count;
+  uint32_t first;
+} SIMRCSortedList;
+
 typedef union SIMRCData {
   SIMRCRule rcrule;
   SIMRCCellVec rccell_vec;
+  SIMRCSortedList sorted_list;
 } SIMRCData;
 
 #define MAX_RCDATA_COUNT (8192 * 2)
+#define MAX_SIM_SORTED_LIST_HASHES 4096
+uint8_t g_sim_sorted_list_hashes[MAX_SIM_SORTED_LIST_HASHES][32];
+uint32_t g_sim_sorted_list_hashes_count = 0;
 
 SIMRCData g_sim_rcdata[MAX_RCDATA_COUNT];
 uint16_t g_sim_rcdata_count = 0;
@@ -55,10 +73,15 @@ mol_seg_t g_structure = {0};
 
 uint8_t g_hash_in_args[32] = {0};
 
-uint8_t g_input_lock_script_hash[32][16];
+// owner script in witness, for enhanced owner mode
+mol_seg_t g_owner_script = {0};
+
+#define MAX_SIM_INPUT_COUNT 4096
+uint8_t g_input_lock_script_hash[MAX_SIM_INPUT_COUNT][32];
 uint32_t g_input_lock_script_hash_count = 0;
 
-uint8_t g_output_lock_script_hash[32][16];
+#define MAX_SIM_OUTPUT_COUNT 16
+uint8_t g_output_lock_script_hash[MAX_SIM_OUTPUT_COUNT][32];
 uint32_t g_output_lock_script_hash_count = 0;
 
 __int128 g_input_amount[32] = {0};
@@ -127,7 +150,7 @@ void xudt_add_data(const uint8_t* data, uint32_t len) {
 }
 
 void xudt_add_input_lock_script_hash(uint8_t* hash) {
-  if (g_input_lock_script_hash_count >= 16) {
+  if (g_input_lock_script_hash_count >= MAX_SIM_INPUT_COUNT) {
     ASSERT(false);
     return;
   }
@@ -141,8 +164,23 @@ void xudt_set_owner_mode(uint8_t* hash_in_args, uint8_t* lock_script_hash) {
   xudt_add_input_lock_script_hash(lock_script_hash);
 }
 
+// the hash of owner script is set to xUDT args. "path" is NULL for a built-in
+// extension.
+void xudt_set_owner_script(const uint8_t* code_hash, uint8_t hash_type,
+                           uint8_t* args, uint32_t args_len, const char* path) {
+  if (g_owner_script.ptr) free(g_owner_script.ptr);
+  g_owner_script = build_script(code_hash, hash_type, args, args_len);
+  int err = blake2b(g_hash_in_args, 32, g_owner_script.ptr,
+                    g_owner_script.size, NULL, 0);
+  ASSERT(err == 0);
+  if (path != NULL) {
+    ckbsim_map_lib(code_hash, path);
+  }
+}
+
 void xudt_add_output_lock_script_hash(uint8_t* hash) {
-  if (g_output_lock_script_hash_count > 16) {
+  if (g_output_lock_script_hash_count >= MAX_SIM_OUTPUT_COUNT) {
+    ASSERT(false);
     return;
   }
   memcpy(g_output_lock_script_hash[g_output_lock_script_hash_count], hash, 32);
@@ -174,12 +212,17 @@ void xudt_begin_data(void) {
   memset(g_input_lock_script_hash, 0, sizeof(g_input_lock_script_hash));
   memset(g_output_lock_script_hash, 0, sizeof(g_output_lock_script_hash));
   memset(g_hash_in_args, 0, sizeof(g_hash_in_args));
+  if (g_owner_script.ptr) free(g_owner_script.ptr);
+  g_owner_script.ptr = 0;
+  g_owner_script.size = 0;
 
   g_lib_size = 0;
+  g_dlopen_count = 0;
   g_input_lock_script_hash_count = 0;
   g_output_lock_script_hash_count = 0;
 
   g_sim_rcdata_count = 0;
+  g_sim_sorted_list_hashes_count = 0;
 }
 
 void xudt_end_data(void) {
@@ -223,6 +266,7 @@ int ckb_checked_load_script_hash(void* addr, uint64_t* len, size_t offset) {
 
 int ckb_load_witness(void* addr, uint64_t* len, size_t offset, size_t index,
                      size_t source) {
+  g_syscall_count++;
   if (index > 1) {
     return 1;  // CKB_INDEX_OUT_OF_BOUND;
   }
@@ -231,6 +275,10 @@ int ckb_load_witness(void* addr, uint64_t* len, size_t offset, size_t index,
 
   mol_builder_t xwi_builder;
   MolBuilder_XudtWitnessInput_init(&xwi_builder);
+  if (g_owner_script.size > 0) {
+    MolBuilder_XudtWitnessInput_set_owner_script(
+        &xwi_builder, g_owner_script.ptr, g_owner_script.size);
+  }
   if (g_flags == 2) {
     MolBuilder_XudtWitnessInput_set_raw_extension_data(
         &xwi_builder, g_extension_script_hash.ptr,
@@ -267,8 +315,10 @@ int ckb_load_witness(void* addr, uint64_t* len, size_t offset, size_t index,
   uint32_t remaining = res.seg.size - offset;
   if (remaining > *len) {
     memcpy(addr, res.seg.ptr + offset, *len);
+    g_witness_read_bytes += *len;
   } else {
     memcpy(addr, res.seg.ptr + offset, remaining);
+    g_witness_read_bytes += remaining;
   }
   *len = remaining;
 
@@ -346,6 +396,26 @@ mol_seg_t build_rcdata(SIMRCData* rcdata) {
 
     MolBuilder_RCData_set_RCCellVec(&b2, res.seg.ptr, res.seg.size);
     free(res.seg.ptr);
+  } else if (rcdata->rcrule.id == 2) {
+    // RCSortedList
+    mol_builder_t b;
+    MolBuilder_Byte32Vec_init(&b);
+    for (uint32_t i = 0; i < rcdata->sorted_list.hash_count; i++) {
+      MolBuilder_Byte32Vec_push(
+          &b, g_sim_sorted_list_hashes[rcdata->sorted_list.first + i]);
+    }
+    mol_seg_res_t hashes = MolBuilder_Byte32Vec_build(b);
+    ASSERT(hashes.errno == 0);
+
+    MolBuilder_RCSortedList_init(&b);
+    MolBuilder_RCSortedList_set_flags(&b, rcdata->sorted_list.flags);
+    MolBuilder_RCSortedList_set_hashes(&b, hashes.seg.ptr, hashes.seg.size);
+    mol_seg_res_t res = MolBuilder_RCSortedList_build(b);
+    ASSERT(res.errno == 0);
+
+    MolBuilder_RCData_set_RCSortedList(&b2, res.seg.ptr, res.seg.size);
+    free(hashes.seg.ptr);
+    free(res.seg.ptr);
   } else {
     ASSERT(false);
   }
@@ -355,6 +425,7 @@ mol_seg_t build_rcdata(SIMRCData* rcdata) {
 }
 
 int ckb_checked_load_script(void* addr, uint64_t* len, size_t offset) {
+  g_syscall_count++;
   mol_builder_t b = {0};
   mol_seg_res_t res = {0};
   assert(offset == 0);
@@ -423,6 +494,7 @@ int ckb_load_cell_code(void* addr, size_t memory_size, size_t content_offset,
 
 int ckb_load_cell_data(void* addr, uint64_t* len, size_t offset, size_t index,
                        size_t source) {
+  g_syscall_count++;
   if (source == CKB_SOURCE_GROUP_INPUT) {
     ASSERT(offset == 0);
     if (index >= g_input_count) {
@@ -492,6 +564,7 @@ int ckb_calculate_inputs_len() { return 0; }
 
 int ckb_load_cell_by_field(void* addr, uint64_t* len, size_t offset,
                            size_t index, size_t source, size_t field) {
+  g_syscall_count++;
   if (field == CKB_CELL_FIELD_LOCK_HASH) {
     if (source == CKB_SOURCE_GROUP_OUTPUT || source == CKB_SOURCE_OUTPUT) {
       ASSERT(offset == 0);
@@ -513,7 +586,16 @@ int ckb_load_cell_by_field(void* addr, uint64_t* len, size_t offset,
       ASSERT(false);
     }
   } else if (field == CKB_CELL_FIELD_TYPE_HASH) {
-    return CKB_INDEX_OUT_OF_BOUND;
+    // RCData cells are the cell deps, with index as the very small hash. See
+    // ckb_look_for_dep_with_hash2 below.
+    if (source != CKB_SOURCE_CELL_DEP || index >= g_sim_rcdata_count) {
+      return CKB_INDEX_OUT_OF_BOUND;
+    }
+    ASSERT(offset == 0);
+    ASSERT(*len >= 32);
+    memset(addr, 0, 32);
+    *((RCHashType*)addr) = (RCHashType)index;
+    *len = 32;
   }
   return 0;
 }
@@ -560,6 +642,30 @@ RCHashType rce_add_rccellvec(RCHashType* hash, uint32_t length) {
   return g_sim_rcdata_count - 1;
 }
 
+static int compare_sorted_list_hash(const void* a, const void* b) {
+  return memcmp(a, b, 32);
+}
+
+// the hashes are sorted here, like the RCE validator requires
+RCHashType rce_add_sorted_list(uint8_t (*hashes)[32], uint32_t length,
+                               uint8_t flags) {
+  ASSERT(g_sim_rcdata_count < countof(g_sim_rcdata));
+  ASSERT(g_sim_sorted_list_hashes_count + length <=
+         MAX_SIM_SORTED_LIST_HASHES);
+  SIMRCData* curr = g_sim_rcdata + g_sim_rcdata_count;
+  curr->sorted_list.id = 2;
+  curr->sorted_list.flags = flags;
+  curr->sorted_list.hash_count = length;
+  curr->sorted_list.first = g_sim_sorted_list_hashes_count;
+  uint8_t(*first)[32] =
+      g_sim_sorted_list_hashes + g_sim_sorted_list_hashes_count;
+  memcpy(first, hashes, length * 32);
+  qsort(first, length, 32, compare_sorted_list_hash);
+  g_sim_sorted_list_hashes_count += length;
+  g_sim_rcdata_count++;
+  return g_sim_rcdata_count - 1;
+}
+
 int ckb_look_for_dep_with_hash2(const uint8_t* code_hash, uint8_t hash_type,
                                 size_t* index) {
   *index = *(uint16_t*)code_hash;
@@ -648,6 +754,9 @@ size_t get_file_size(const char* path) {
   return size;
 }
 
+// count of ckb_dlopen2 calls
+int g_dlopen_count = 0;
+
 int ckb_dlopen2(const uint8_t* dep_cell_hash, uint8_t hash_type,
                 uint8_t* aligned_addr, size_t aligned_size, void** handle,
                 size_t* consumed_size) {
@@ -663,7 +772,10 @@ int ckb_dlopen2(const uint8_t* dep_cell_hash, uint8_t hash_type,
   ASSERT(err == 0);
 
   *handle = dlopen(path, RTLD_NOW);
-  *consumed_size = 0;
+  // pretend every library takes one page
+  *consumed_size = RISCV_PGSIZE;
+  g_dlopen_count++;
+  g_syscall_count++;
 
   if (*handle == NULL) {
     printf("Error occurs in dlopen: %s\n", dlerror());
@@ -673,10 +785,9 @@ int ckb_dlopen2(const uint8_t* dep_cell_hash, uint8_t hash_type,
   return 0;
 }
 
+// same as ckb_dlsym, NULL is returned for a missing symbol
 void* ckb_dlsym(void* handle, const char* symbol) {
-  void* ret = dlsym(handle, symbol);
-  ASSERT(ret != NULL);
-  return ret;
+  return dlsym(handle, symbol);
 }
 
 #undef ASSERT
@@ -0,0 +1,49 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ckb_consts.h"
+#include "xudt_extension.h"
+
+// it should not be called when "validate2" is exported
+__attribute__((visibility("default"))) int validate(int is_owner_mode,
+                                                    size_t extension_index,
+                                                    const uint8_t* args,
+                                                    size_t args_len) {
+  return 1;
+}
+
+__attribute__((visibility("default"))) int validate2(
+    const XudtValidateContext* ctx) {
+  if (ctx->version < XUDT_VALIDATE_CONTEXT_VERSION) return 2;
+  const XudtHostApi* host = ctx->host;
+  if (host == NULL || host->version < XUDT_HOST_API_VERSION) return 8;
+  // as an owner script, it accepts without loading anything
+  if (ctx->args_len == 1) return 0;
+  if (ctx->args_len != 32) return 3;
+  if (ctx->xudt_args_len < 32 || ctx->raw_extension_data_len == 0) return 4;
+  unsigned __int128 input_amount = 0;
+  unsigned __int128 output_amount = 0;
+  if (host->load_group_amounts(&input_amount, &output_amount) != 0) return 5;
+  if (input_amount < output_amount) return 6;
+  const uint8_t* input_lock_hashes = NULL;
+  uint32_t input_lock_hashes_count = 0;
+  if (host->load_input_lock_hashes(&input_lock_hashes,
+                                   &input_lock_hashes_count) != 0 ||
+      input_lock_hashes_count == 0)
+    return 7;
+
+  uint8_t hash[32];
+  if (host->hash(hash, ctx->args, ctx->args_len) != 0) return 9;
+  // lock script hash of input in set_basic_data
+  uint8_t input_lock_script_hash[32] = {11};
+  bool found = false;
+  if (host->find_cell_hash(CKB_SOURCE_INPUT, CKB_CELL_FIELD_LOCK_HASH,
+                           input_lock_script_hash, &found) != 0 ||
+      !found)
+    return 10;
+  if (host->find_cell_hash(CKB_SOURCE_INPUT, CKB_CELL_FIELD_LOCK_HASH, hash,
+                           &found) != 0 ||
+      found)
+    return 11;
+  return 0;
+}
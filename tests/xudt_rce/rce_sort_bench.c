@@ -0,0 +1,78 @@
+// Compares rce_state_normalize with smt_state_normalize on the host. It's not
+// a test. The numbers are host clock ticks: they say nothing about cycles in
+// CKB-VM, where the cost of both sorts has not been measured. Build the target
+// "rce_sort_bench" and run it.
+#define ASSERT(s) (void)0
+
+int ckb_exit(signed char code);
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "xudt_rce.c"
+
+smt_pair_t g_pairs[MAX_LOCK_SCRIPT_HASH_COUNT];
+smt_pair_t g_expected[MAX_LOCK_SCRIPT_HASH_COUNT];
+
+// "len" pairs with duplicated keys, some of them share a long prefix
+void fill_pairs(uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    smt_pair_t* pair = &g_pairs[i];
+    if (i > 0 && rand() % 4 == 0) {
+      memcpy(pair->key, g_pairs[rand() % i].key, SMT_KEY_BYTES);
+    } else {
+      for (int j = 0; j < SMT_KEY_BYTES; j++) {
+        pair->key[j] = (uint8_t)rand();
+      }
+      if (rand() % 4 == 0) {
+        memset(pair->key + 2, 0x55, SMT_KEY_BYTES - 2);
+      }
+    }
+    memset(pair->value, 0, SMT_VALUE_BYTES);
+    memcpy(pair->value, &i, sizeof(i));
+  }
+}
+
+int main() {
+  uint32_t sizes[3] = {64, 512, 2048};
+  for (int k = 0; k < 3; k++) {
+    uint32_t len = sizes[k];
+    int rounds = 204800 / len;
+    clock_t costs[2] = {0};
+    for (int round = 0; round < rounds; round++) {
+      fill_pairs(len);
+      memcpy(g_expected, g_pairs, len * sizeof(smt_pair_t));
+      smt_state_t expected;
+      smt_state_init(&expected, g_expected, len);
+      expected.len = len;
+      clock_t start = clock();
+      smt_state_normalize(&expected);
+      costs[0] += clock() - start;
+
+      smt_state_t states;
+      smt_state_init(&states, g_pairs, len);
+      states.len = len;
+      start = clock();
+      rce_state_normalize(&states);
+      costs[1] += clock() - start;
+
+      // "order" is used differently, only keys and values are compared
+      bool same = expected.len == states.len;
+      for (uint32_t i = 0; same && i < states.len; i++) {
+        same = memcmp(expected.pairs[i].key, states.pairs[i].key,
+                      SMT_KEY_BYTES) == 0 &&
+               memcmp(expected.pairs[i].value, states.pairs[i].value,
+                      SMT_VALUE_BYTES) == 0;
+      }
+      if (!same) {
+        printf("rce_state_normalize differs from smt_state_normalize\n");
+        return 1;
+      }
+    }
+    printf("normalize %u keys x %d, host clock ticks: "
+           "smt_state_normalize = %ld, rce_state_normalize = %ld\n",
+           len, rounds, (long)costs[0], (long)costs[1]);
+  }
+  return 0;
+}
@@ -6,6 +6,19 @@
 
 int ckb_exit(signed char code);
 
+#include <stddef.h>
+#include <stdint.h>
+
+// a built-in extension, dispatched without dlopen
+uint8_t BUILTIN_TEST_HASH[32] = {0x88};
+int g_builtin_test_called = 0;
+int builtin_test_validate(int is_owner_mode, size_t extension_index,
+                          const uint8_t* args, size_t args_len) {
+  g_builtin_test_called++;
+  return 0;
+}
+#define XUDT_EXTRA_BUILTINS_FILE "xudt_rce_sim_builtins.h"
+
 #include "utest.h"
 #include "xudt_rce.c"
 void debug_print_hex(const char* prefix, const uint8_t* buf, size_t length) {
@@ -189,6 +202,67 @@ exit:
   ASSERT_EQ(err, 0);
 }
 
+UTEST(xudt_many_scripts, raw_extension_data_bigger_than_64k) {
+  int err = 0;
+
+  xudt_begin_data();
+  set_basic_data();
+
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[64] = {0};
+  // about 100 bytes per script, raw extension data is streamed from witness
+  for (int i = 0; i < 700; i++) {
+    xudt_add_extension_script(
+        extension_hash, 1, args, sizeof(args),
+        "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  }
+  xudt_end_data();
+  ASSERT_GT(g_extension_script_hash.size, 65536);
+
+  xudt_set_flags(2);
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(g_dlopen_count, 1);
+exit:
+  return;
+}
+
+UTEST(xudt_many_scripts, raw_extension_data_in_witness_cost) {
+  int err = 0;
+  // small enough to be loaded as a whole, and bigger than g_extension_script
+  int counts[2] = {16, 700};
+  int syscalls[2] = {0};
+  uint64_t bytes[2] = {0};
+  uint32_t sizes[2] = {0};
+  for (int round = 0; round < 2; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+    uint8_t args[64] = {0};
+    for (int i = 0; i < counts[round]; i++) {
+      xudt_add_extension_script(
+          extension_hash, 1, args, sizeof(args),
+          "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+    }
+    xudt_end_data();
+    xudt_set_flags(2);
+    sizes[round] = g_extension_script_hash.size;
+
+    g_syscall_count = 0;
+    g_witness_read_bytes = 0;
+    err = simulator_main();
+    ASSERT_EQ(err, 0);
+    syscalls[round] = g_syscall_count;
+    bytes[round] = g_witness_read_bytes;
+  }
+  // the list is read in windows, the syscalls don't grow with the scripts
+  ASSERT_LT(syscalls[1] - syscalls[0], counts[1] / 8);
+  // read twice at most: once to check and hash it, once to run the scripts
+  for (int round = 0; round < 2; round++) {
+    ASSERT_LE(bytes[round], 2 * (uint64_t)sizes[round] + SCRIPT_SIZE);
+  }
+}
+
 UTEST(rce, white_list) {
   int err = 0;
   xudt_begin_data();
@@ -210,6 +284,425 @@ exit:
   return;
 }
 
+UTEST(rce, arena_peak) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule =
+      rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);  // white list
+  rce_begin_proof();
+  rce_add_proof(WHITE_LIST_PROOF, countof(WHITE_LIST_PROOF), 0x3);
+  rce_end_proof();
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(arena_peak(XudtPhaseArgs), 0);
+  // the short proof is borrowed from the cache of witness
+  ASSERT_EQ(arena_peak(XudtPhaseExtensions),
+            (uint32_t)(RCE_ARENA_SIZE -
+                       ARENA_ROUND_UP(MAX_RCE_PROOF_LENGTH)));
+  // only the RceState is kept for the next RCE extensions
+  ASSERT_EQ(arena_mark(), arena_peak(XudtPhaseExtensions));
+  rce_reset();
+  arena_reset();
+  ASSERT_EQ(arena_mark(), 0);
+exit:
+  return;
+}
+
+UTEST(rce, cell_index) {
+  xudt_begin_data();
+  for (int i = 0; i < 8; i++) {
+    rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);
+  }
+  xudt_end_data();
+
+  RceState* rce_state = arena_alloc(sizeof(RceState));
+  ASSERT_TRUE(rce_state != NULL);
+  rce_init_state(rce_state);
+  rce_build_cell_index(&rce_state->cell_index, false);
+  ASSERT_EQ(rce_state->cell_index.count, 8);
+  ASSERT_TRUE(rce_state->cell_index.deps_complete);
+
+  // found without scanning the cell deps again
+  uint8_t hash[32] = {0};
+  *((RCHashType*)hash) = 5;
+  size_t index = 0;
+  size_t source = 0;
+  g_syscall_count = 0;
+  int err = rce_find_rcdata_cell(rce_state, hash, &index, &source);
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(index, 5);
+  ASSERT_EQ(source, CKB_SOURCE_CELL_DEP);
+  ASSERT_EQ(g_syscall_count, 0);
+
+  *((RCHashType*)hash) = 8;
+  err = rce_find_rcdata_cell(rce_state, hash, &index, &source);
+  ASSERT_EQ(err, CKB_INDEX_OUT_OF_BOUND);
+  ASSERT_EQ(g_syscall_count, 0);
+  arena_reset();
+}
+
+static int gather_rcrules(RCHashType root, RceState** rce_state,
+                          int* syscall_count) {
+  uint8_t hash[32] = {0};
+  *((RCHashType*)hash) = root;
+  *rce_state = arena_alloc(sizeof(RceState));
+  rce_init_state(*rce_state);
+  rce_build_cell_index(&(*rce_state)->cell_index, false);
+  g_syscall_count = 0;
+  int err = rce_gather_rcrules(*rce_state, hash);
+  *syscall_count = g_syscall_count;
+  return err;
+}
+
+UTEST(rce, shared_rc_cell_vec_is_loaded_once) {
+  xudt_begin_data();
+  uint8_t hash_root[32] = {1};
+  RCHashType base[2];
+  base[0] = rce_add_rcrule(hash_root, 0x0);
+  hash_root[0] = 2;
+  base[1] = rce_add_rcrule(hash_root, 0x2);
+  RCHashType shared = rce_add_rccellvec(base, 2);
+  RCHashType once = rce_add_rccellvec(&shared, 1);
+  RCHashType twice_vec[2] = {shared, shared};
+  RCHashType twice = rce_add_rccellvec(twice_vec, 2);
+  xudt_end_data();
+
+  RceState* rce_state = NULL;
+  int once_count = 0;
+  int err = gather_rcrules(once, &rce_state, &once_count);
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(rce_state->rcrules_count, 2);
+  arena_reset();
+
+  int twice_count = 0;
+  err = gather_rcrules(twice, &rce_state, &twice_count);
+  ASSERT_EQ(err, 0);
+  // same depth-first order as loading the shared cells again
+  ASSERT_EQ(rce_state->rcrules_count, 4);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(rce_state->rcrules[i].smt_root[0], 1 + i % 2);
+    ASSERT_EQ(rce_state->rcrules[i].flags, (i % 2) * 2);
+  }
+  ASSERT_TRUE(rce_state->has_wl);
+  // the shared cells are not loaded again
+  ASSERT_LE(twice_count, once_count + 1);
+  arena_reset();
+}
+
+UTEST(rce, rcdata_cell_is_loaded_once) {
+  xudt_begin_data();
+  RCHashType rcrulevec[MAX_RCRULE_IN_CELL] = {0};
+  for (int i = 0; i < MAX_RCRULE_IN_CELL; i++) {
+    uint8_t hash_root[32] = {(uint8_t)i};
+    rcrulevec[i] = rce_add_rcrule(hash_root, 0x0);
+  }
+  RCHashType root = rce_add_rccellvec(rcrulevec, MAX_RCRULE_IN_CELL);
+  xudt_end_data();
+
+  RceState* rce_state = NULL;
+  int syscall_count = 0;
+  int err = gather_rcrules(root, &rce_state, &syscall_count);
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(rce_state->rcrules_count, MAX_RCRULE_IN_CELL);
+  // one syscall for every RCData cell
+  ASSERT_EQ(syscall_count, MAX_RCRULE_IN_CELL + 1);
+  arena_reset();
+
+  // bigger than the cache: the rest is read on demand
+  uint8_t data_source_buff[MOL2_DATA_SOURCE_LEN(64)];
+  mol2_cursor_t cell_data;
+  g_syscall_count = 0;
+  err = rce_make_cursor_from_cell_data(data_source_buff, 64, &cell_data, root,
+                                       CKB_SOURCE_CELL_DEP);
+  ASSERT_EQ(err, 0);
+  RCDataType rc_data = make_RCData(&cell_data);
+  ASSERT_EQ(rc_data.t->item_id(&rc_data), RCDataUnionCellVec);
+  RCCellVecType cell_vec = rc_data.t->as_RCCellVec(&rc_data);
+  ASSERT_EQ(cell_vec.t->len(&cell_vec), MAX_RCRULE_IN_CELL);
+  ASSERT_EQ(g_syscall_count, 1);
+  bool existing = false;
+  mol2_cursor_t item =
+      cell_vec.t->get(&cell_vec, MAX_RCRULE_IN_CELL - 1, &existing);
+  ASSERT_TRUE(existing);
+  uint8_t hash[32] = {0};
+  ASSERT_EQ(mol2_read_at(&item, hash, sizeof(hash)), sizeof(hash));
+  ASSERT_EQ(*((RCHashType*)hash), rcrulevec[MAX_RCRULE_IN_CELL - 1]);
+  ASSERT_EQ(g_syscall_count, 2);
+}
+
+UTEST(rce, rcrules_shared_by_rce_extensions) {
+  int err = 0;
+  int costs[2] = {0};
+  for (int round = 0; round < 2; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint16_t rcrulevec[MAX_RCRULE_IN_CELL] = {0};
+    for (int i = 0; i < MAX_RCRULE_IN_CELL; i++) {
+      rcrulevec[i] = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+    }
+    RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, MAX_RCRULE_IN_CELL);
+    // one RCE extension in first round, two in second round
+    for (int i = 0; i <= round; i++) {
+      rce_begin_proof();
+      for (int j = 0; j < MAX_RCRULE_IN_CELL; j++) {
+        rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+      }
+      rce_end_proof();
+      uint8_t args[32] = {0};
+      memcpy(args, &root_rcrule, 2);
+      xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                                "internal extension script, no path");
+    }
+    xudt_end_data();
+
+    g_syscall_count = 0;
+    err = simulator_main();
+    ASSERT_EQ(err, 0);
+    costs[round] = g_syscall_count;
+  }
+  // lock hashes and RCData cells are not loaded again, only the proofs
+  ASSERT_LT((costs[1] - costs[0]) * 4, costs[0]);
+exit:
+  return;
+}
+
+UTEST(rce, proof_tail_out_of_cache) {
+  int err = 0;
+  // the head of proof is in the cache filled by its SmtProofEntry, the tail
+  // isn't for the longer ones
+  uint32_t proof_lens[4] = {1024, 1900, 2000, MAX_CACHE_SIZE - 4};
+  for (int i = 0; i < 4; i++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint16_t root_rcrule =
+        rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);  // white list
+    uint8_t* proof = malloc(proof_lens[i]);
+    memset(proof, 0x4C, proof_lens[i]);
+    rce_begin_proof();
+    rce_add_proof(proof, proof_lens[i], 0x3);
+    rce_end_proof();
+    free(proof);
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+
+    err = simulator_main();
+    ASSERT_EQ(ERROR_NOT_ON_WHITE_LIST, err);
+    // borrowed from the cache, no buffer is allocated for it
+    ASSERT_EQ(arena_peak(XudtPhaseExtensions),
+              (uint32_t)(RCE_ARENA_SIZE -
+                         ARENA_ROUND_UP(MAX_RCE_PROOF_LENGTH)));
+  }
+exit:
+  return;
+}
+
+UTEST(rce, proof_longer_than_32k) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule =
+      rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);  // white list
+  // it used to be rejected as ERROR_INVALID_MOL_FORMAT before smt_verify
+  uint32_t proof_len = 40 * 1024;
+  uint8_t* proof = malloc(proof_len);
+  memset(proof, 0x4C, proof_len);
+  rce_begin_proof();
+  rce_add_proof(proof, proof_len, 0x3);
+  rce_end_proof();
+  free(proof);
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_NOT_ON_WHITE_LIST, err);
+  // read into a buffer of its exact size
+  ASSERT_EQ(arena_peak(XudtPhaseExtensions),
+            (uint32_t)(RCE_ARENA_SIZE - ARENA_ROUND_UP(MAX_RCE_PROOF_LENGTH) +
+                       ARENA_ROUND_UP(proof_len)));
+exit:
+  return;
+}
+
+UTEST(rce, owner_script_is_rce) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule =
+      rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);  // white list
+  // longer than the cache of mol2, it's read into arena
+  uint32_t proof_len = 4 * 1024;
+  uint8_t* proof = malloc(proof_len);
+  memset(proof, 0x4C, proof_len);
+  rce_begin_proof();
+  rce_add_proof(proof, proof_len, 0x3);
+  rce_end_proof();
+  free(proof);
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  // it fails, so owner mode is off. The RCE state it creates is released
+  // with the arena of owner mode.
+  xudt_set_owner_script(RCE_HASH, 1, args, sizeof(args), NULL);
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_NOT_ON_WHITE_LIST, err);
+  // the state of the extension is kept in arena, the proof is not read over it
+  ASSERT_TRUE(g_rce_state != NULL);
+  ASSERT_LE((uint8_t*)(g_rce_state + 1), g_arena_buff + arena_mark());
+exit:
+  return;
+}
+
+UTEST(rce, normalize_hashes) {
+  smt_pair_t entries[64];
+  smt_pair_t expected_entries[64];
+  smt_state_t states;
+  smt_state_t expected;
+  smt_state_init(&states, entries, countof(entries));
+  smt_state_init(&expected, expected_entries, countof(expected_entries));
+  for (int i = 0; i < 64; i++) {
+    uint8_t key[SMT_KEY_BYTES] = {0};
+    // 16 distinct keys, differ in first and last bytes
+    key[0] = (uint8_t)(i % 16);
+    key[SMT_KEY_BYTES - 1] = (uint8_t)((i % 16) * 37);
+    smt_state_insert(&states, key, SMT_VALUE_EMPTY);
+    // keys 0-7 only in inputs, 8-11 in both, 12-15 only in outputs
+    int k = i % 16;
+    states.pairs[i].order = k < 8 ? RCE_IN_INPUT
+                            : k < 12 ? (i < 32 ? RCE_IN_INPUT : RCE_IN_OUTPUT)
+                                     : RCE_IN_OUTPUT;
+    smt_state_insert(&expected, key, SMT_VALUE_EMPTY);
+  }
+  rce_normalize_hashes(&states);
+  smt_state_normalize(&expected);
+  ASSERT_EQ(states.len, expected.len);
+  for (uint32_t i = 0; i < states.len; i++) {
+    ASSERT_EQ(0, memcmp(states.pairs[i].key, expected.pairs[i].key,
+                        SMT_KEY_BYTES));
+    int k = states.pairs[i].key[0];
+    uint32_t bits = k < 8    ? RCE_IN_INPUT
+                    : k < 12 ? (RCE_IN_INPUT | RCE_IN_OUTPUT)
+                             : RCE_IN_OUTPUT;
+    ASSERT_EQ(states.pairs[i].order, bits);
+  }
+}
+
+UTEST(rce, mixed_black_and_white_lists) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t rcrulevec[4] = {0};
+  rce_begin_proof();
+  for (int i = 0; i < 4; i++) {
+    if (i % 2 == 0) {
+      rcrulevec[i] = rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);
+      rce_add_proof(WHITE_LIST_PROOF, countof(WHITE_LIST_PROOF), 0x3);
+    } else {
+      rcrulevec[i] = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+      rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+    }
+  }
+  rce_end_proof();
+  RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, 4);
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  // the values of states are switched between rules
+  err = simulator_main();
+  ASSERT_EQ(0, err);
+exit:
+  return;
+}
+
+UTEST(rce, sorted_list) {
+  int err = 0;
+  // lock script hashes are 11 (input) and 22 (output)
+  uint8_t lists[4][2] = {{11, 22}, {11, 33}, {33, 44}, {22, 44}};
+  uint8_t flags[4] = {0x2, 0x2, 0x0, 0x0};
+  int expected[4] = {0, ERROR_NOT_ON_WHITE_LIST, 0, ERROR_ON_BLACK_LIST};
+  for (int round = 0; round < 4; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint8_t hashes[3][32] = {{lists[round][1]}, {lists[round][0]}, {55}};
+    RCHashType rcrulevec[2] = {0};
+    rcrulevec[0] = rce_add_sorted_list(hashes, 3, flags[round]);
+    rcrulevec[1] = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+    RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, 2);
+    // only the RCRule with SMT has a proof
+    rce_begin_proof();
+    rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+    rce_end_proof();
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+
+    err = simulator_main();
+    ASSERT_EQ(expected[round], err);
+  }
+exit:
+  return;
+}
+
+UTEST(rce, sorted_list_cost) {
+  int err = 0;
+  // a white list with SMT, then sorted lists of different sizes
+  uint32_t sizes[4] = {0, 8, 31, 256};
+  int costs[4] = {0};
+  for (int round = 0; round < 4; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    RCHashType root_rcrule = 0;
+    rce_begin_proof();
+    if (sizes[round] == 0) {
+      root_rcrule = rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);
+      rce_add_proof(WHITE_LIST_PROOF, countof(WHITE_LIST_PROOF), 0x3);
+    } else {
+      uint8_t hashes[256][32] = {{11}, {22}};
+      for (uint32_t i = 2; i < sizes[round]; i++) {
+        hashes[i][0] = 100;
+        hashes[i][1] = (uint8_t)i;
+      }
+      root_rcrule = rce_add_sorted_list(hashes, sizes[round], 0x2);
+    }
+    rce_end_proof();
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+
+    g_syscall_count = 0;
+    err = simulator_main();
+    ASSERT_EQ(err, 0);
+    costs[round] = g_syscall_count;
+  }
+  // the list fits in the cache of RCData cell, it's loaded once
+  ASSERT_EQ(costs[1], costs[2]);
+  ASSERT_LE(costs[2], costs[0]);
+exit:
+  return;
+}
+
 UTEST(rce, both_input_and_output_on_white_list) {
   int err = 0;
   xudt_begin_data();
@@ -376,6 +869,31 @@ exit:
   return;
 }
 
+UTEST(xudt, plain_owner_mode_is_resolved_on_demand) {
+  int err = 0;
+  uint8_t hash0[BLAKE2B_BLOCK_SIZE] = {0};
+  uint8_t hash1[BLAKE2B_BLOCK_SIZE] = {1};
+
+  // issuance is only allowed in owner mode
+  xudt_begin_data();
+  xudt_set_flags(0);
+  xudt_add_input_amount(999);
+  xudt_add_output_amount(1000);
+  xudt_set_owner_mode(hash0, hash0);
+  xudt_end_data();
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+
+  xudt_begin_data();
+  xudt_set_flags(0);
+  xudt_add_input_amount(999);
+  xudt_add_output_amount(1000);
+  xudt_set_owner_mode(hash0, hash1);
+  xudt_end_data();
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_AMOUNT);
+}
+
 UTEST(xudt, emergency_halt_mode) {
   int err = 0;
   xudt_begin_data();
@@ -397,6 +915,35 @@ exit:
   return;
 }
 
+UTEST(xudt, emergency_halt_after_black_list_hit) {
+  // RCRules are verified in order: the first failure is reported
+  int expected[2] = {ERROR_ON_BLACK_LIST, ERROR_RCE_EMERGENCY_HALT};
+  for (int round = 0; round < 2; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    // invalid hash, so the verify result is false: it's on black list.
+    uint8_t invalid_hash[32] = {0};
+    uint16_t black_list = rce_add_rcrule(invalid_hash, 0x0);
+    uint16_t halt = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x1);
+    uint16_t rcrulevec[2] = {black_list, halt};
+    if (round == 1) {
+      rcrulevec[0] = halt;
+      rcrulevec[1] = black_list;
+    }
+    RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, 2);
+    rce_begin_proof();
+    rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+    rce_end_proof();
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+    int err = simulator_main();
+    ASSERT_EQ(expected[round], err);
+  }
+}
+
 UTEST(xudt, extension_script_is_validated) {
   int err = 0;
 
@@ -427,6 +974,229 @@ exit:
   return;
 }
 
+UTEST(xudt, extension_script_is_validated_with_many_inputs) {
+  int err = 0;
+
+  xudt_begin_data();
+
+  xudt_set_flags(1);
+  xudt_add_input_amount(999);
+  xudt_add_output_amount(999);
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  uint8_t hash[32];
+  xudt_calc_extension_script_hash(extension_hash, 1, args, sizeof(args), hash);
+  // more inputs than MAX_LOCK_SCRIPT_HASH_COUNT, but only a few distinct locks
+  for (int i = 0; i < 3000; i++) {
+    uint8_t input_lock_script_hash[32] = {11};
+    input_lock_script_hash[1] = i % 16;
+    xudt_add_input_lock_script_hash(input_lock_script_hash);
+  }
+  xudt_add_input_lock_script_hash(hash);
+  uint8_t output_lock_script_hash[32] = {22};
+  xudt_add_output_lock_script_hash(output_lock_script_hash);
+
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+exit:
+  return;
+}
+
+UTEST(xudt, extension_script_is_validated_with_many_distinct_locks) {
+  int err = 0;
+
+  xudt_begin_data();
+
+  xudt_set_flags(1);
+  xudt_add_input_amount(999);
+  xudt_add_output_amount(999);
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+
+  // it returns non-zero if it's executed
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_1.dylib");
+  uint8_t hash[32];
+  xudt_calc_extension_script_hash(extension_hash, 1, args, sizeof(args), hash);
+  // too many distinct locks to keep in memory
+  for (int i = 0; i < MAX_LOCK_SCRIPT_HASH_COUNT + 1; i++) {
+    uint8_t input_lock_script_hash[32] = {33};
+    memcpy(input_lock_script_hash + 1, &i, sizeof(i));
+    xudt_add_input_lock_script_hash(input_lock_script_hash);
+  }
+  xudt_add_input_lock_script_hash(hash);
+  uint8_t output_lock_script_hash[32] = {22};
+  xudt_add_output_lock_script_hash(output_lock_script_hash);
+
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+exit:
+  return;
+}
+
+UTEST(xudt, extension_script_is_validated_with_few_duplicated_locks) {
+  int err = 0;
+
+  xudt_begin_data();
+
+  xudt_set_flags(1);
+  xudt_add_input_amount(999);
+  xudt_add_output_amount(999);
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+
+  // it returns non-zero if it's executed
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_1.dylib");
+  uint8_t hash[32];
+  xudt_calc_extension_script_hash(extension_hash, 1, args, sizeof(args), hash);
+  // compacting the first MAX_LOCK_SCRIPT_HASH_COUNT inputs frees less than a
+  // quarter of the buffer, it's not sorted again for every following input
+  for (int i = 0; i < 3200; i++) {
+    uint8_t input_lock_script_hash[32] = {44};
+    int lock = i % 1600;
+    memcpy(input_lock_script_hash + 1, &lock, sizeof(lock));
+    xudt_add_input_lock_script_hash(input_lock_script_hash);
+  }
+  xudt_add_input_lock_script_hash(hash);
+  uint8_t output_lock_script_hash[32] = {22};
+  xudt_add_output_lock_script_hash(output_lock_script_hash);
+
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_TRUE((g_tx_ctx.loaded & TX_CTX_TOO_MANY_LOCKS) != 0);
+exit:
+  return;
+}
+
+UTEST(xudt, extension_library_loaded_once) {
+  int err = 0;
+
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+  for (int i = 0; i < 3; i++) {
+    args[0] = i;
+    xudt_add_extension_script(
+        extension_hash, 1, args, sizeof(args),
+        "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  }
+  // validated by input lock, the library is never loaded
+  uint8_t validated_hash[BLAKE2B_BLOCK_SIZE] = {0x77};
+  uint8_t hash[32];
+  xudt_add_extension_script(
+      validated_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_1.dylib");
+  xudt_calc_extension_script_hash(validated_hash, 1, args, sizeof(args), hash);
+  xudt_add_input_lock_script_hash(hash);
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(g_dlopen_count, 1);
+exit:
+  return;
+}
+
+UTEST(xudt, extension_library_pages_kept) {
+  int err = 0;
+
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t args[32] = {0};
+  // code 0x66 is used twice, it's loaded once. Code pages are frozen by
+  // ckb_dlopen2, they're never given back.
+  uint8_t code_hashes[4] = {0x66, 0x67, 0x66, 0x68};
+  for (int i = 0; i < countof(code_hashes); i++) {
+    uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {code_hashes[i]};
+    xudt_add_extension_script(
+        extension_hash, 1, args, sizeof(args),
+        "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  }
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(g_dlopen_count, 3);
+  ASSERT_EQ(g_code_used, 3 * RISCV_PGSIZE);
+exit:
+  return;
+}
+
+UTEST(xudt, extension_script_validate2) {
+  int err = 0;
+
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x69};
+  uint8_t args[32] = {0};
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_2.dylib");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+exit:
+  return;
+}
+
+UTEST(xudt, owner_script_validate2_loads_on_demand) {
+  int err = 0;
+
+  xudt_begin_data();
+  uint8_t lock_script_hash[32] = {11};
+  xudt_add_input_lock_script_hash(lock_script_hash);
+  xudt_add_input_amount(1);
+  xudt_add_output_amount(2);
+  // it accepts with 1 byte args, without loading anything
+  uint8_t owner_hash[BLAKE2B_BLOCK_SIZE] = {0x6a};
+  uint8_t args[1] = {0};
+  xudt_set_owner_script(
+      owner_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_2.dylib");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(g_dlopen_count, 1);
+  ASSERT_EQ(g_tx_ctx.loaded & TX_CTX_INPUT_LOCK_HASHES, 0);
+exit:
+  return;
+}
+
+UTEST(xudt, builtin_extension) {
+  int err = 0;
+
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t args[32] = {0};
+  xudt_add_extension_script(BUILTIN_TEST_HASH, 1, args, sizeof(args),
+                            "built-in extension script, no path");
+  xudt_end_data();
+
+  g_builtin_test_called = 0;
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+  ASSERT_EQ(g_builtin_test_called, 1);
+  ASSERT_EQ(g_dlopen_count, 0);
+exit:
+  return;
+}
+
 UTEST(xudt, extension_script_returns_non_zero) {
   int err = 0;
   xudt_begin_data();
@@ -444,6 +1214,216 @@ exit:
   return;
 }
 
+UTEST(reject, malformed_extension_script) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  // an empty table, not a Script
+  uint8_t malformed_script[4] = {4, 0, 0, 0};
+  MolBuilder_ScriptVec_push(&g_extension_script_hash_builder, malformed_script,
+                            sizeof(malformed_script));
+  xudt_end_data();
+  xudt_set_flags(2);
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_INVALID_ARGS_FORMAT, err);
+  // nothing is loaded before the malformed script is found
+  ASSERT_EQ(g_dlopen_count, 0);
+  ASSERT_EQ(g_tx_ctx.loaded & (TX_CTX_INPUT_LOCK_HASHES | TX_CTX_GROUP_AMOUNTS),
+            0);
+exit:
+  return;
+}
+
+UTEST(reject, malformed_streamed_extension_script) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[64] = {0};
+  // bigger than g_extension_script, it's verified while being hashed
+  for (int i = 0; i < 700; i++) {
+    xudt_add_extension_script(
+        extension_hash, 1, args, sizeof(args),
+        "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  }
+  uint8_t malformed_script[4] = {4, 0, 0, 0};
+  MolBuilder_ScriptVec_push(&g_extension_script_hash_builder, malformed_script,
+                            sizeof(malformed_script));
+  xudt_end_data();
+  xudt_set_flags(2);
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_INVALID_MOL_FORMAT, err);
+  ASSERT_EQ(g_dlopen_count, 0);
+exit:
+  return;
+}
+
+UTEST(reject, missing_rce_proofs) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint8_t extension_hash[BLAKE2B_BLOCK_SIZE] = {0x66};
+  uint8_t args[32] = {0};
+  xudt_add_extension_script(
+      extension_hash, 1, args, sizeof(args),
+      "tests/xudt_rce/simulator-build-debug/libextension_script_0.dylib");
+  uint16_t root_rcrule = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  // no extension data in witness
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_INVALID_MOL_FORMAT, err);
+  ASSERT_EQ(g_dlopen_count, 0);
+  ASSERT_EQ(g_tx_ctx.loaded & TX_CTX_GROUP_AMOUNTS, 0);
+exit:
+  return;
+}
+
+UTEST(reject, malformed_rce_proofs) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+  // total size in header doesn't match
+  uint8_t malformed_proofs[8] = {12, 0, 0, 0, 8, 0, 0, 0};
+  xudt_add_structure_item(malformed_proofs, sizeof(malformed_proofs));
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_INVALID_MOL_FORMAT, err);
+  // rejected before the amount check
+  ASSERT_EQ(g_tx_ctx.loaded & TX_CTX_GROUP_AMOUNTS, 0);
+exit:
+  return;
+}
+
+UTEST(reject, rcrules_proofs_mismatched) {
+  int err = 0;
+  int proof_counts[2] = {MAX_RCRULE_IN_CELL, 1};
+  int costs[2] = {0};
+  for (int round = 0; round < 2; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint16_t rcrulevec[MAX_RCRULE_IN_CELL] = {0};
+    for (int i = 0; i < MAX_RCRULE_IN_CELL; i++) {
+      rcrulevec[i] = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x0);
+    }
+    RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, MAX_RCRULE_IN_CELL);
+    rce_begin_proof();
+    for (int i = 0; i < proof_counts[round]; i++) {
+      rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+    }
+    rce_end_proof();
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+
+    g_syscall_count = 0;
+    err = simulator_main();
+    costs[round] = g_syscall_count;
+  }
+  ASSERT_EQ(ERROR_RCRULES_PROOFS_MISMATCHED, err);
+  // the rest of RCData cells are not loaded, one syscall for each
+  ASSERT_GE(costs[0] - costs[1], MAX_RCRULE_IN_CELL - 2);
+exit:
+  return;
+}
+
+UTEST(reject, not_on_white_list) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule = rce_add_rcrule(WHITE_LIST_HASH_ROOT, 0x2);
+  rce_begin_proof();
+  rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+  rce_end_proof();
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_NOT_ON_WHITE_LIST, err);
+  ASSERT_EQ(g_dlopen_count, 0);
+exit:
+  return;
+}
+
+UTEST(reject, emergency_halt) {
+  int err = 0;
+  xudt_begin_data();
+  set_basic_data();
+  uint16_t root_rcrule = rce_add_rcrule(BLACK_LIST_HASH_ROOT, 0x1);
+  rce_begin_proof();
+  rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+  rce_end_proof();
+  uint8_t args[32] = {0};
+  memcpy(args, &root_rcrule, 2);
+  xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                            "internal extension script, no path");
+  xudt_end_data();
+
+  err = simulator_main();
+  ASSERT_EQ(ERROR_RCE_EMERGENCY_HALT, err);
+  ASSERT_EQ(g_dlopen_count, 0);
+exit:
+  return;
+}
+
+UTEST(reject, black_list_hit_stops_traversal) {
+  int err = 0;
+  int hit_indexes[2] = {MAX_RCRULE_IN_CELL - 1, 0};
+  int costs[2] = {0};
+  for (int round = 0; round < 2; round++) {
+    xudt_begin_data();
+    set_basic_data();
+    uint16_t rcrulevec[MAX_RCRULE_IN_CELL] = {0};
+    for (int i = 0; i < MAX_RCRULE_IN_CELL; i++) {
+      // invalid hash, so the verify result is false: it's on black list.
+      uint8_t invalid_hash[32] = {0};
+      rcrulevec[i] = rce_add_rcrule(
+          i == hit_indexes[round] ? invalid_hash : BLACK_LIST_HASH_ROOT, 0x0);
+    }
+    RCHashType root_rcrule = rce_add_rccellvec(rcrulevec, MAX_RCRULE_IN_CELL);
+    rce_begin_proof();
+    for (int i = 0; i < MAX_RCRULE_IN_CELL; i++) {
+      rce_add_proof(BLACK_LIST_PROOF, countof(BLACK_LIST_PROOF), 0x3);
+    }
+    rce_end_proof();
+    uint8_t args[32] = {0};
+    memcpy(args, &root_rcrule, 2);
+    xudt_add_extension_script(RCE_HASH, 1, args, sizeof(args),
+                              "internal extension script, no path");
+    xudt_end_data();
+
+    g_syscall_count = 0;
+    err = simulator_main();
+    ASSERT_EQ(ERROR_ON_BLACK_LIST, err);
+    costs[round] = g_syscall_count;
+  }
+  // the RCData cells after the hit are not loaded, one syscall for each
+  ASSERT_GE(costs[0] - costs[1], MAX_RCRULE_IN_CELL - 1);
+exit:
+  return;
+}
+
 UTEST(rce, use_rc_cell_vec) {
   int err = 0;
   // prepare basic data
@@ -926,4 +1906,86 @@ UTEST(smt, test_state_normalize) {
   }
 }
 
+smt_pair_t g_sort_pairs[MAX_LOCK_SCRIPT_HASH_COUNT];
+smt_pair_t g_sort_expected[MAX_LOCK_SCRIPT_HASH_COUNT];
+
+// "len" pairs with duplicated keys, some of them share a long prefix
+void fill_sort_pairs(uint32_t len) {
+  for (uint32_t i = 0; i < len; i++) {
+    smt_pair_t* pair = &g_sort_pairs[i];
+    if (i > 0 && rand() % 4 == 0) {
+      memcpy(pair->key, g_sort_pairs[rand() % i].key, SMT_KEY_BYTES);
+    } else {
+      for (int j = 0; j < SMT_KEY_BYTES; j++) {
+        pair->key[j] = (uint8_t)rand();
+      }
+      if (rand() % 4 == 0) {
+        memset(pair->key + 2, 0x55, SMT_KEY_BYTES - 2);
+      }
+    }
+    memset(pair->value, 0, SMT_VALUE_BYTES);
+    memcpy(pair->value, &i, sizeof(i));
+  }
+}
+
+UTEST(smt, rce_state_normalize) {
+  uint32_t sizes[] = {1, 2, 17, 64, 512, 2048};
+  for (int round = 0; round < 100; round++) {
+    for (int k = 0; k < countof(sizes); k++) {
+      uint32_t len = sizes[k];
+      fill_sort_pairs(len);
+      memcpy(g_sort_expected, g_sort_pairs, len * sizeof(smt_pair_t));
+      smt_state_t expected;
+      smt_state_init(&expected, g_sort_expected, len);
+      expected.len = len;
+      smt_state_normalize(&expected);
+      smt_state_t states;
+      smt_state_init(&states, g_sort_pairs, len);
+      states.len = len;
+      rce_state_normalize(&states);
+
+      ASSERT_EQ(expected.len, states.len);
+      for (uint32_t i = 0; i < states.len; i++) {
+        ASSERT_EQ(0, memcmp(expected.pairs[i].key, states.pairs[i].key,
+                            SMT_KEY_BYTES));
+        ASSERT_EQ(0, memcmp(expected.pairs[i].value, states.pairs[i].value,
+                            SMT_VALUE_BYTES));
+      }
+    }
+  }
+}
+
+UTEST(smt, rce_collect_hashes_when_full) {
+  xudt_begin_data();
+  for (uint32_t i = 0; i < MAX_LOCK_SCRIPT_HASH_COUNT; i++) {
+    uint8_t hash[32] = {44};
+    memcpy(hash + 1, &i, sizeof(i));
+    xudt_add_input_lock_script_hash(hash);
+  }
+  // the buffer is full, these are merged into the pairs of inputs
+  uint32_t output_locks[2] = {7, MAX_LOCK_SCRIPT_HASH_COUNT - 1};
+  for (int i = 0; i < 2; i++) {
+    uint8_t hash[32] = {44};
+    memcpy(hash + 1, &output_locks[i], sizeof(uint32_t));
+    xudt_add_output_lock_script_hash(hash);
+  }
+  xudt_end_data();
+
+  memset(g_sort_pairs, 0xFF, sizeof(g_sort_pairs));
+  smt_state_t states;
+  smt_state_init(&states, g_sort_pairs, MAX_LOCK_SCRIPT_HASH_COUNT);
+  int err = rce_collect_hashes(&states);
+  ASSERT_EQ(0, err);
+  ASSERT_EQ(MAX_LOCK_SCRIPT_HASH_COUNT, states.len);
+  for (uint32_t i = 0; i < states.len; i++) {
+    uint32_t lock = 0;
+    memcpy(&lock, states.pairs[i].key + 1, sizeof(lock));
+    uint32_t expected = RCE_IN_INPUT;
+    if (lock == output_locks[0] || lock == output_locks[1]) {
+      expected |= RCE_IN_OUTPUT;
+    }
+    ASSERT_EQ(expected, states.pairs[i].order);
+  }
+}
+
 UTEST_MAIN();
@@ -0,0 +1,3 @@
+// extra built-in extensions compiled into the simulator, see
+// XUDT_EXTRA_BUILTINS_FILE in xudt_rce.c
+{BUILTIN_TEST_HASH, 1, CateNormal, builtin_test_validate},
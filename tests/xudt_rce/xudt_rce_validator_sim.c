@@ -6,7 +6,7 @@ int ckb_exit(signed char code);
 #include "utest.h"
 
 // make compiler happy
-int make_cursor_from_witness(WitnessArgsType *witness, bool *use_input_type) {
+int get_extension_data_cursor(uint32_t index, mol2_cursor_t *cur) {
   ASSERT(false);
   return -1;
 }
@@ -668,4 +668,159 @@ exit:
   ASSERT_EQ(err, 0);
 }
 
+void add_sorted_list(int output, const uint8_t (*hashes)[32],
+                     uint8_t hash_count) {
+  SIMRCData *curr = g_sim_rcdata[output] + g_sim_rcdata_count[output];
+  curr->sorted_list.id = 2;
+  curr->sorted_list.flags = 0;
+  curr->sorted_list.hash_count = hash_count;
+  curr->sorted_list.hashes = hashes;
+  g_sim_rcdata_count[output] += 1;
+}
+
+UTEST(rce_validator, sorted_list_append_only) {
+  const uint8_t old_list[2][32] = {{1}, {3}};
+  const uint8_t appended[3][32] = {{1}, {2}, {3}};
+  const uint8_t removed[2][32] = {{1}, {2}};
+  int err = 0;
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  add_sorted_list(0, old_list, 2);
+  add_sorted_list(1, appended, 3);
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  add_sorted_list(0, old_list, 2);
+  add_sorted_list(1, removed, 2);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_APPEND_ONLY);
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  add_sorted_list(0, appended, 3);
+  add_sorted_list(1, old_list, 1);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_APPEND_ONLY);
+
+  // it can be removed without append only
+  rce_validator_init();
+  add_sorted_list(0, old_list, 2);
+  add_sorted_list(1, removed, 2);
+  err = simulator_main();
+  ASSERT_EQ(err, 0);
+}
+
+UTEST(rce_validator, sorted_list_unsorted) {
+  const uint8_t old_list[2][32] = {{1}, {3}};
+  const uint8_t unsorted[3][32] = {{1}, {3}, {2}};
+  int err = 0;
+
+  // created
+  rce_validator_init();
+  g_cell_group_exists[0][0] = 0;
+  add_sorted_list(1, unsorted, 3);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_UNSORTED_LIST);
+
+  // updated, xUDT trusts the order when it looks the hashes up
+  rce_validator_init();
+  add_sorted_list(0, old_list, 2);
+  add_sorted_list(1, unsorted, 3);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_UNSORTED_LIST);
+}
+
+UTEST(rce_validator, sorted_list_duplicated) {
+  const uint8_t old_list[2][32] = {{1}, {3}};
+  const uint8_t duplicated[3][32] = {{1}, {3}, {3}};
+  int err = 0;
+
+  rce_validator_init();
+  g_cell_group_exists[0][0] = 0;
+  add_sorted_list(1, duplicated, 3);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_UNSORTED_LIST);
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  add_sorted_list(0, old_list, 2);
+  add_sorted_list(1, duplicated, 3);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_UNSORTED_LIST);
+}
+
+UTEST(rce_validator, rcrule_to_sorted_list_with_freeze_type) {
+  const uint8_t hashes[1][32] = {{1}};
+  int err = 0;
+
+  rce_validator_init();
+  g_script_flags = 0x2;
+  SIMRCData *curr_0 = g_sim_rcdata[0] + g_sim_rcdata_count[0];
+  curr_0->rcrule.id = 0;
+  curr_0->rcrule.flags = 0;
+  memcpy(curr_0->rcrule.smt_root, smt_one_root, countof(smt_one_root));
+  g_sim_rcdata_count[0] += 1;
+  add_sorted_list(1, hashes, 1);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_TYPE_FREEZED);
+}
+
+UTEST(rce_validator, rccellvec_to_sorted_list_with_freeze_type) {
+  const uint8_t hashes[1][32] = {{1}};
+  int err = 0;
+
+  rce_validator_init();
+  g_script_flags = 0x2;
+  SIMRCData *curr_0 = g_sim_rcdata[0] + g_sim_rcdata_count[0];
+  curr_0->rccell_vec.id = 1;
+  curr_0->rccell_vec.hash_count = 0;
+  memset(curr_0->rccell_vec.hash, 0, 32);
+  g_sim_rcdata_count[0] += 1;
+  add_sorted_list(1, hashes, 1);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_TYPE_FREEZED);
+
+  // and back
+  rce_validator_init();
+  g_script_flags = 0x2;
+  add_sorted_list(0, hashes, 1);
+  SIMRCData *curr_1 = g_sim_rcdata[1] + g_sim_rcdata_count[1];
+  curr_1->rccell_vec.id = 1;
+  curr_1->rccell_vec.hash_count = 0;
+  memset(curr_1->rccell_vec.hash, 0, 32);
+  g_sim_rcdata_count[1] += 1;
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_TYPE_FREEZED);
+}
+
+UTEST(rce_validator, type_change_with_append_only) {
+  const uint8_t hashes[1][32] = {{1}};
+  int err = 0;
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  SIMRCData *curr_0 = g_sim_rcdata[0] + g_sim_rcdata_count[0];
+  curr_0->rcrule.id = 0;
+  curr_0->rcrule.flags = 0;
+  memcpy(curr_0->rcrule.smt_root, smt_one_root, countof(smt_one_root));
+  g_sim_rcdata_count[0] += 1;
+  add_sorted_list(1, hashes, 1);
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_APPEND_ONLY);
+
+  rce_validator_init();
+  g_script_flags = 0x1;
+  add_sorted_list(0, hashes, 1);
+  SIMRCData *curr_1 = g_sim_rcdata[1] + g_sim_rcdata_count[1];
+  curr_1->rccell_vec.id = 1;
+  curr_1->rccell_vec.hash_count = 0;
+  memset(curr_1->rccell_vec.hash, 0, 32);
+  g_sim_rcdata_count[1] += 1;
+  err = simulator_main();
+  ASSERT_EQ(err, ERROR_APPEND_ONLY);
+}
+
 UTEST_MAIN();
@@ -1261,6 +1261,268 @@ impl<'t: 'r, 'r> ::core::iter::ExactSizeIterator for RCCellVecReaderIterator<'t,
     }
 }
 #[derive(Clone)]
+pub struct RCSortedList(molecule::bytes::Bytes);
+impl ::core::fmt::LowerHex for RCSortedList {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        use molecule::hex_string;
+        if f.alternate() {
+            write!(f, "0x")?;
+        }
+        write!(f, "{}", hex_string(self.as_slice()))
+    }
+}
+impl ::core::fmt::Debug for RCSortedList {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        write!(f, "{}({:#x})", Self::NAME, self)
+    }
+}
+impl ::core::fmt::Display for RCSortedList {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        write!(f, "{} {{ ", Self::NAME)?;
+        write!(f, "{}: {}", "flags", self.flags())?;
+        write!(f, ", {}: {}", "hashes", self.hashes())?;
+        let extra_count = self.count_extra_fields();
+        if extra_count != 0 {
+            write!(f, ", .. ({} fields)", extra_count)?;
+        }
+        write!(f, " }}")
+    }
+}
+impl ::core::default::Default for RCSortedList {
+    fn default() -> Self {
+        let v: Vec<u8> = vec![17, 0, 0, 0, 12, 0, 0, 0, 13, 0, 0, 0, 0, 0, 0, 0, 0];
+        RCSortedList::new_unchecked(v.into())
+    }
+}
+impl RCSortedList {
+    pub const FIELD_COUNT: usize = 2;
+    pub fn total_size(&self) -> usize {
+        molecule::unpack_number(self.as_slice()) as usize
+    }
+    pub fn field_count(&self) -> usize {
+        if self.total_size() == molecule::NUMBER_SIZE {
+            0
+        } else {
+            (molecule::unpack_number(&self.as_slice()[molecule::NUMBER_SIZE..]) as usize / 4) - 1
+        }
+    }
+    pub fn count_extra_fields(&self) -> usize {
+        self.field_count() - Self::FIELD_COUNT
+    }
+    pub fn has_extra_fields(&self) -> bool {
+        Self::FIELD_COUNT != self.field_count()
+    }
+    pub fn flags(&self) -> Byte {
+        let slice = self.as_slice();
+        let start = molecule::unpack_number(&slice[4..]) as usize;
+        let end = molecule::unpack_number(&slice[8..]) as usize;
+        Byte::new_unchecked(self.0.slice(start..end))
+    }
+    pub fn hashes(&self) -> Byte32Vec {
+        let slice = self.as_slice();
+        let start = molecule::unpack_number(&slice[8..]) as usize;
+        if self.has_extra_fields() {
+            let end = molecule::unpack_number(&slice[12..]) as usize;
+            Byte32Vec::new_unchecked(self.0.slice(start..end))
+        } else {
+            Byte32Vec::new_unchecked(self.0.slice(start..))
+        }
+    }
+    pub fn as_reader<'r>(&'r self) -> RCSortedListReader<'r> {
+        RCSortedListReader::new_unchecked(self.as_slice())
+    }
+}
+impl molecule::prelude::Entity for RCSortedList {
+    type Builder = RCSortedListBuilder;
+    const NAME: &'static str = "RCSortedList";
+    fn new_unchecked(data: molecule::bytes::Bytes) -> Self {
+        RCSortedList(data)
+    }
+    fn as_bytes(&self) -> molecule::bytes::Bytes {
+        self.0.clone()
+    }
+    fn as_slice(&self) -> &[u8] {
+        &self.0[..]
+    }
+    fn from_slice(slice: &[u8]) -> molecule::error::VerificationResult<Self> {
+        RCSortedListReader::from_slice(slice).map(|reader| reader.to_entity())
+    }
+    fn from_compatible_slice(slice: &[u8]) -> molecule::error::VerificationResult<Self> {
+        RCSortedListReader::from_compatible_slice(slice).map(|reader| reader.to_entity())
+    }
+    fn new_builder() -> Self::Builder {
+        ::core::default::Default::default()
+    }
+    fn as_builder(self) -> Self::Builder {
+        Self::new_builder()
+            .flags(self.flags())
+            .hashes(self.hashes())
+    }
+}
+#[derive(Clone, Copy)]
+pub struct RCSortedListReader<'r>(&'r [u8]);
+impl<'r> ::core::fmt::LowerHex for RCSortedListReader<'r> {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        use molecule::hex_string;
+        if f.alternate() {
+            write!(f, "0x")?;
+        }
+        write!(f, "{}", hex_string(self.as_slice()))
+    }
+}
+impl<'r> ::core::fmt::Debug for RCSortedListReader<'r> {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        write!(f, "{}({:#x})", Self::NAME, self)
+    }
+}
+impl<'r> ::core::fmt::Display for RCSortedListReader<'r> {
+    fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
+        write!(f, "{} {{ ", Self::NAME)?;
+        write!(f, "{}: {}", "flags", self.flags())?;
+        write!(f, ", {}: {}", "hashes", self.hashes())?;
+        let extra_count = self.count_extra_fields();
+        if extra_count != 0 {
+            write!(f, ", .. ({} fields)", extra_count)?;
+        }
+        write!(f, " }}")
+    }
+}
+impl<'r> RCSortedListReader<'r> {
+    pub const FIELD_COUNT: usize = 2;
+    pub fn total_size(&self) -> usize {
+        molecule::unpack_number(self.as_slice()) as usize
+    }
+    pub fn field_count(&self) -> usize {
+        if self.total_size() == molecule::NUMBER_SIZE {
+            0
+        } else {
+            (molecule::unpack_number(&self.as_slice()[molecule::NUMBER_SIZE..]) as usize / 4) - 1
+        }
+    }
+    pub fn count_extra_fields(&self) -> usize {
+        self.field_count() - Self::FIELD_COUNT
+    }
+    pub fn has_extra_fields(&self) -> bool {
+        Self::FIELD_COUNT != self.field_count()
+    }
+    pub fn flags(&self) -> ByteReader<'r> {
+        let slice = self.as_slice();
+        let start = molecule::unpack_number(&slice[4..]) as usize;
+        let end = molecule::unpack_number(&slice[8..]) as usize;
+        ByteReader::new_unchecked(&self.as_slice()[start..end])
+    }
+    pub fn hashes(&self) -> Byte32VecReader<'r> {
+        let slice = self.as_slice();
+        let start = molecule::unpack_number(&slice[8..]) as usize;
+        if self.has_extra_fields() {
+            let end = molecule::unpack_number(&slice[12..]) as usize;
+            Byte32VecReader::new_unchecked(&self.as_slice()[start..end])
+        } else {
+            Byte32VecReader::new_unchecked(&self.as_slice()[start..])
+        }
+    }
+}
+impl<'r> molecule::prelude::Reader<'r> for RCSortedListReader<'r> {
+    type Entity = RCSortedList;
+    const NAME: &'static str = "RCSortedListReader";
+    fn to_entity(&self) -> Self::Entity {
+        Self::Entity::new_unchecked(self.as_slice().to_owned().into())
+    }
+    fn new_unchecked(slice: &'r [u8]) -> Self {
+        RCSortedListReader(slice)
+    }
+    fn as_slice(&self) -> &'r [u8] {
+        self.0
+    }
+    fn verify(slice: &[u8], compatible: bool) -> molecule::error::VerificationResult<()> {
+        use molecule::verification_error as ve;
+        let slice_len = slice.len();
+        if slice_len < molecule::NUMBER_SIZE {
+            return ve!(Self, HeaderIsBroken, molecule::NUMBER_SIZE, slice_len);
+        }
+        let total_size = molecule::unpack_number(slice) as usize;
+        if slice_len != total_size {
+            return ve!(Self, TotalSizeNotMatch, total_size, slice_len);
+        }
+        if slice_len == molecule::NUMBER_SIZE && Self::FIELD_COUNT == 0 {
+            return Ok(());
+        }
+        if slice_len < molecule::NUMBER_SIZE * 2 {
+            return ve!(Self, HeaderIsBroken, molecule::NUMBER_SIZE * 2, slice_len);
+        }
+        let offset_first = molecule::unpack_number(&slice[molecule::NUMBER_SIZE..]) as usize;
+        if offset_first % molecule::NUMBER_SIZE != 0 || offset_first < molecule::NUMBER_SIZE * 2 {
+            return ve!(Self, OffsetsNotMatch);
+        }
+        if slice_len < offset_first {
+            return ve!(Self, HeaderIsBroken, offset_first, slice_len);
+        }
+        let field_count = offset_first / molecule::NUMBER_SIZE - 1;
+        if field_count < Self::FIELD_COUNT {
+            return ve!(Self, FieldCountNotMatch, Self::FIELD_COUNT, field_count);
+        } else if !compatible && field_count > Self::FIELD_COUNT {
+            return ve!(Self, FieldCountNotMatch, Self::FIELD_COUNT, field_count);
+        };
+        let mut offsets: Vec<usize> = slice[molecule::NUMBER_SIZE..offset_first]
+            .chunks_exact(molecule::NUMBER_SIZE)
+            .map(|x| molecule::unpack_number(x) as usize)
+            .collect();
+        offsets.push(total_size);
+        if offsets.windows(2).any(|i| i[0] > i[1]) {
+            return ve!(Self, OffsetsNotMatch);
+        }
+        ByteReader::verify(&slice[offsets[0]..offsets[1]], compatible)?;
+        Byte32VecReader::verify(&slice[offsets[1]..offsets[2]], compatible)?;
+        Ok(())
+    }
+}
+#[derive(Debug, Default)]
+pub struct RCSortedListBuilder {
+    pub(crate) flags: Byte,
+    pub(crate) hashes: Byte32Vec,
+}
+impl RCSortedListBuilder {
+    pub const FIELD_COUNT: usize = 2;
+    pub fn flags(mut self, v: Byte) -> Self {
+        self.flags = v;
+        self
+    }
+    pub fn hashes(mut self, v: Byte32Vec) -> Self {
+        self.hashes = v;
+        self
+    }
+}
+impl molecule::prelude::Builder for RCSortedListBuilder {
+    type Entity = RCSortedList;
+    const NAME: &'static str = "RCSortedListBuilder";
+    fn expected_length(&self) -> usize {
+        molecule::NUMBER_SIZE * (Self::FIELD_COUNT + 1)
+            + self.flags.as_slice().len()
+            + self.hashes.as_slice().len()
+    }
+    fn write<W: molecule::io::Write>(&self, writer: &mut W) -> molecule::io::Result<()> {
+        let mut total_size = molecule::NUMBER_SIZE * (Self::FIELD_COUNT + 1);
+        let mut offsets = Vec::with_capacity(Self::FIELD_COUNT);
+        offsets.push(total_size);
+        total_size += self.flags.as_slice().len();
+        offsets.push(total_size);
+        total_size += self.hashes.as_slice().len();
+        writer.write_all(&molecule::pack_number(total_size as molecule::Number))?;
+        for offset in offsets.into_iter() {
+            writer.write_all(&molecule::pack_number(offset as molecule::Number))?;
+        }
+        writer.write_all(self.flags.as_slice())?;
+        writer.write_all(self.hashes.as_slice())?;
+        Ok(())
+    }
+    fn build(&self) -> Self::Entity {
+        let mut inner = Vec::with_capacity(self.expected_length());
+        self.write(&mut inner)
+            .unwrap_or_else(|_| panic!("{} build should be ok", Self::NAME));
+        RCSortedList::new_unchecked(inner.into())
+    }
+}
+#[derive(Clone)]
 pub struct RCData(molecule::bytes::Bytes);
 impl ::core::fmt::LowerHex for RCData {
     fn fmt(&self, f: &mut ::core::fmt::Formatter) -> ::core::fmt::Result {
@@ -1293,7 +1555,7 @@ impl ::core::default::Default for RCData {
     }
 }
 impl RCData {
-    pub const ITEMS_COUNT: usize = 2;
+    pub const ITEMS_COUNT: usize = 3;
     pub fn item_id(&self) -> molecule::Number {
         molecule::unpack_number(self.as_slice())
     }
@@ -1302,6 +1564,7 @@ impl RCData {
         match self.item_id() {
             0 => RCRule::new_unchecked(inner).into(),
             1 => RCCellVec::new_unchecked(inner).into(),
+            2 => RCSortedList::new_unchecked(inner).into(),
             _ => panic!("{}: invalid data", Self::NAME),
         }
     }
@@ -1358,7 +1621,7 @@ impl<'r> ::core::fmt::Display for RCDataReader<'r> {
     }
 }
 impl<'r> RCDataReader<'r> {
-    pub const ITEMS_COUNT: usize = 2;
+    pub const ITEMS_COUNT: usize = 3;
     pub fn item_id(&self) -> molecule::Number {
         molecule::unpack_number(self.as_slice())
     }
@@ -1367,6 +1630,7 @@ impl<'r> RCDataReader<'r> {
         match self.item_id() {
             0 => RCRuleReader::new_unchecked(inner).into(),
             1 => RCCellVecReader::new_unchecked(inner).into(),
+            2 => RCSortedListReader::new_unchecked(inner).into(),
             _ => panic!("{}: invalid data", Self::NAME),
         }
     }
@@ -1394,6 +1658,7 @@ impl<'r> molecule::prelude::Reader<'r> for RCDataReader<'r> {
         match item_id {
             0 => RCRuleReader::verify(inner_slice, compatible),
             1 => RCCellVecReader::verify(inner_slice, compatible),
+            2 => RCSortedListReader::verify(inner_slice, compatible),
             _ => ve!(Self, UnknownItem, Self::ITEMS_COUNT, item_id),
         }?;
         Ok(())
@@ -1402,7 +1667,7 @@ impl<'r> molecule::prelude::Reader<'r> for RCDataReader<'r> {
 #[derive(Debug, Default)]
 pub struct RCDataBuilder(pub(crate) RCDataUnion);
 impl RCDataBuilder {
-    pub const ITEMS_COUNT: usize = 2;
+    pub const ITEMS_COUNT: usize = 3;
     pub fn set<I>(mut self, v: I) -> Self
     where
         I: ::core::convert::Into<RCDataUnion>,
@@ -1432,11 +1697,13 @@ impl molecule::prelude::Builder for RCDataBuilder {
 pub enum RCDataUnion {
     RCRule(RCRule),
     RCCellVec(RCCellVec),
+    RCSortedList(RCSortedList),
 }
 #[derive(Debug, Clone, Copy)]
 pub enum RCDataUnionReader<'r> {
     RCRule(RCRuleReader<'r>),
     RCCellVec(RCCellVecReader<'r>),
+    RCSortedList(RCSortedListReader<'r>),
 }
 impl ::core::default::Default for RCDataUnion {
     fn default() -> Self {
@@ -1452,6 +1719,9 @@ impl ::core::fmt::Display for RCDataUnion {
             RCDataUnion::RCCellVec(ref item) => {
                 write!(f, "{}::{}({})", Self::NAME, RCCellVec::NAME, item)
             }
+            RCDataUnion::RCSortedList(ref item) => {
+                write!(f, "{}::{}({})", Self::NAME, RCSortedList::NAME, item)
+            }
         }
     }
 }
@@ -1464,6 +1734,9 @@ impl<'r> ::core::fmt::Display for RCDataUnionReader<'r> {
             RCDataUnionReader::RCCellVec(ref item) => {
                 write!(f, "{}::{}({})", Self::NAME, RCCellVec::NAME, item)
             }
+            RCDataUnionReader::RCSortedList(ref item) => {
+                write!(f, "{}::{}({})", Self::NAME, RCSortedList::NAME, item)
+            }
         }
     }
 }
@@ -1472,6 +1745,7 @@ impl RCDataUnion {
         match self {
             RCDataUnion::RCRule(ref item) => write!(f, "{}", item),
             RCDataUnion::RCCellVec(ref item) => write!(f, "{}", item),
+            RCDataUnion::RCSortedList(ref item) => write!(f, "{}", item),
         }
     }
 }
@@ -1480,6 +1754,7 @@ impl<'r> RCDataUnionReader<'r> {
         match self {
             RCDataUnionReader::RCRule(ref item) => write!(f, "{}", item),
             RCDataUnionReader::RCCellVec(ref item) => write!(f, "{}", item),
+            RCDataUnionReader::RCSortedList(ref item) => write!(f, "{}", item),
         }
     }
 }
@@ -1493,6 +1768,11 @@ impl ::core::convert::From<RCCellVec> for RCDataUnion {
         RCDataUnion::RCCellVec(item)
     }
 }
+impl ::core::convert::From<RCSortedList> for RCDataUnion {
+    fn from(item: RCSortedList) -> Self {
+        RCDataUnion::RCSortedList(item)
+    }
+}
 impl<'r> ::core::convert::From<RCRuleReader<'r>> for RCDataUnionReader<'r> {
     fn from(item: RCRuleReader<'r>) -> Self {
         RCDataUnionReader::RCRule(item)
@@ -1503,36 +1783,46 @@ impl<'r> ::core::convert::From<RCCellVecReader<'r>> for RCDataUnionReader<'r> {
         RCDataUnionReader::RCCellVec(item)
     }
 }
+impl<'r> ::core::convert::From<RCSortedListReader<'r>> for RCDataUnionReader<'r> {
+    fn from(item: RCSortedListReader<'r>) -> Self {
+        RCDataUnionReader::RCSortedList(item)
+    }
+}
 impl RCDataUnion {
     pub const NAME: &'static str = "RCDataUnion";
     pub fn as_bytes(&self) -> molecule::bytes::Bytes {
         match self {
             RCDataUnion::RCRule(item) => item.as_bytes(),
             RCDataUnion::RCCellVec(item) => item.as_bytes(),
+            RCDataUnion::RCSortedList(item) => item.as_bytes(),
         }
     }
     pub fn as_slice(&self) -> &[u8] {
         match self {
             RCDataUnion::RCRule(item) => item.as_slice(),
             RCDataUnion::RCCellVec(item) => item.as_slice(),
+            RCDataUnion::RCSortedList(item) => item.as_slice(),
         }
     }
     pub fn item_id(&self) -> molecule::Number {
         match self {
             RCDataUnion::RCRule(_) => 0,
             RCDataUnion::RCCellVec(_) => 1,
+            RCDataUnion::RCSortedList(_) => 2,
         }
     }
     pub fn item_name(&self) -> &str {
         match self {
             RCDataUnion::RCRule(_) => "RCRule",
             RCDataUnion::RCCellVec(_) => "RCCellVec",
+            RCDataUnion::RCSortedList(_) => "RCSortedList",
         }
     }
     pub fn as_reader<'r>(&'r self) -> RCDataUnionReader<'r> {
         match self {
             RCDataUnion::RCRule(item) => item.as_reader().into(),
             RCDataUnion::RCCellVec(item) => item.as_reader().into(),
+            RCDataUnion::RCSortedList(item) => item.as_reader().into(),
         }
     }
 }
@@ -1542,18 +1832,21 @@ impl<'r> RCDataUnionReader<'r> {
         match self {
             RCDataUnionReader::RCRule(item) => item.as_slice(),
             RCDataUnionReader::RCCellVec(item) => item.as_slice(),
+            RCDataUnionReader::RCSortedList(item) => item.as_slice(),
         }
     }
     pub fn item_id(&self) -> molecule::Number {
         match self {
             RCDataUnionReader::RCRule(_) => 0,
             RCDataUnionReader::RCCellVec(_) => 1,
+            RCDataUnionReader::RCSortedList(_) => 2,
         }
     }
     pub fn item_name(&self) -> &str {
         match self {
             RCDataUnionReader::RCRule(_) => "RCRule",
             RCDataUnionReader::RCCellVec(_) => "RCCellVec",
+            RCDataUnionReader::RCSortedList(_) => "RCSortedList",
         }
     }
 }